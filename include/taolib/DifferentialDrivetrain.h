@@ -15,13 +15,23 @@
 #include <vector>
 #include <ratio>
 #include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <string>
 
 #include "env.h"
 
 #include "Vector2.h"
 #include "PIDController.h"
+#include "Feedforward.h"
+#include "RateScheduler.h"
 #include "threading.h"
 #include "Logger.h"
+#include "telemetry.h"
+#include "SensorFrame.h"
+#include "FlightRecorder.h"
+#include "profiling.h"
+#include "trace.h"
 
 namespace tao {
 
@@ -30,6 +40,77 @@ namespace tao {
  */
 class DifferentialDrivetrain {
 public:
+	/**
+	 * Describes the state of the most recent movement, including why it ended.
+	 */
+	enum class MoveStatus {
+		/** The movement is still in progress. */
+		Moving,
+
+		/** The drivetrain reached its target and settled. */
+		Settled,
+
+		/** The drivetrain was commanded to move, but its wheels stopped turning (e.g. it is pushing against a wall). */
+		Stalled,
+
+		/** The imu detected a sudden impact with another object. */
+		Collided
+	};
+
+	/**
+	 * Measurements of how a single movement performed, recorded when the movement ends.
+	 * Times are in microseconds, and distances are in the same units as the drivetrain's config.
+	 */
+	struct MoveMetrics {
+		/** Name of the movement function that started the movement (such as "drive" or "move_to"). */
+		const char* name;
+
+		/** Times that the movement started and ended, since tracking started. */
+		uint32_t start_time, end_time;
+
+		/** Time from the start of the movement until both errors were first within tolerance, or 0 if they never were. */
+		uint32_t reach_time;
+
+		/** Time from the start of the movement until it settled, or 0 if it didn't settle. */
+		uint32_t settle_time;
+
+		/** Furthest that the drivetrain went past its target distance (or point), and past its target heading in degrees. */
+		double drive_overshoot, turn_overshoot;
+
+		/** Errors of the drive and turn controllers when the movement ended. */
+		double final_drive_error, final_turn_error;
+
+		/** Largest voltage applied to either side of the drivetrain during the movement. */
+		double peak_voltage;
+
+		/** Why the movement ended. MoveStatus::Moving means it was replaced by another movement before it finished. */
+		MoveStatus status;
+	};
+
+	/**
+	 * A part of the tracking loop that is timed while profiling is compiled in (see get_timing()).
+	 */
+	enum class TimingStage {
+		/** Each stage of the loop, in the order that they run. */
+		Sensors,
+		Odometry,
+		Path,
+		Control,
+		Velocity,
+		Output,
+		Settle,
+		Faults,
+		Diagnostics,
+		Telemetry,
+		Status,
+
+		/** A full tick of the loop, including every stage that ran on it and the flight recorder. */
+		Tick,
+
+		/** How late each tick started compared to when it was scheduled, caused by sleep_for oversleeping or the previous tick overrunning. */
+		Wakeup
+	};
+
 	/**
 	 * A structure describing values specific to the drivetrain's physical state.
 	 * @attention These values are unique to each drivetrain and must be specifically tuned.
@@ -66,6 +147,44 @@ public:
 		 * The external gear ratio of the robot as a quotient (INPUT TEETH / OUTPUT TEETH).
 		 */
 		double gearing;
+
+		/** The PID tuning constants used by the inner velocity PID controllers on each side of the drivetrain. */
+		PIDController::Gains velocity_gains;
+
+		/**
+		 * The maximum linear velocity (in distance units per second) that each side of the drivetrain can reach.
+		 * @note Setting this to a non-zero value enables the inner velocity loop. The drive and turn controllers will
+		 * then output velocity setpoints, which are tracked using wheel velocity feedback rather than open-loop voltage.
+		 */
+		double max_velocity;
+
+		/**
+		 * The feedforward constants of the left side of the drivetrain, used by the inner velocity loop.
+		 * @note These can be measured automatically using DifferentialDrivetrain::characterize. If left zeroed, the velocity
+		 * loop will assume that voltage scales linearly with velocity up to max_velocity.
+		 */
+		Feedforward::Gains left_feedforward;
+
+		/** The feedforward constants of the right side of the drivetrain, used by the inner velocity loop. */
+		Feedforward::Gains right_feedforward;
+
+		/**
+		 * The amount of time (in milliseconds) that the drivetrain can be commanded to move without its wheels turning before the movement is aborted.
+		 * @note Stall detection is only enabled when both this and stall_velocity are above 0.
+		 */
+		uint32_t stall_time;
+
+		/**
+		 * The wheel velocity (in distance units per second) below which a side of the drivetrain is considered stalled.
+		 * @note Stall detection is only enabled when both this and stall_time are above 0.
+		 */
+		double stall_velocity;
+
+		/**
+		 * The planar acceleration (in g) measured by the imu that is considered a collision, aborting the current movement.
+		 * @note Setting this to 0 disables collision detection.
+		 */
+		double collision_acceleration;
 	} Config;
 
 	// Constructors
@@ -152,6 +271,12 @@ public:
 
 	double get_forward_travel() const;
 
+	/**
+	 * Gets the current linear velocity of each side of the drivetrain.
+	 * @return A pair representing the velocity of the left and right wheels of the drivetrain in distance units per second.
+	 */
+	std::pair<double, double> get_wheel_velocities() const;
+
 	/**
 	 * Gets the current counter-clockwise heading of the drivetrain in degrees.
 	 * @note If the imu is not configured or installed, the heading will be calculated based on encoders only, using the drivetrain's track width measurements.
@@ -171,6 +296,12 @@ public:
 	 */
 	PIDController::Gains get_turn_gains() const;
 
+	/**
+	 * Gets the current gains of the inner velocity PID controllers.
+	 * @return The current gains as a PIDController::Gains struct.
+	 */
+	PIDController::Gains get_velocity_gains() const;
+
 	/**
 	 * Gets the current error of the drive PID controller.
 	 * @return The current drive error (distance between the desired position and the current position).
@@ -225,6 +356,18 @@ public:
 	 */
 	double get_max_turn_power() const;
 
+	/**
+	 * Gets the maximum linear velocity of each side of the drivetrain used by the inner velocity loop.
+	 * @return The maximum wheel velocity in distance units per second, or 0 if the velocity loop is disabled.
+	 */
+	double get_max_velocity() const;
+
+	/**
+	 * Gets the feedforward constants used by the inner velocity loop.
+	 * @return A pair containing the left and right Feedforward::Gains of the drivetrain.
+	 */
+	std::pair<Feedforward::Gains, Feedforward::Gains> get_feedforward_gains() const;
+
 	/**
 	 * Generates a DifferentialDrivetrain::Config structure from the current drivetrain state.
 	 * @return The current drivetrain config.
@@ -237,13 +380,35 @@ public:
 	 */
 	bool is_settled();
 
+	/**
+	 * Gets a number identifying the most recent movement. Each movement function starts a new movement with a new id,
+	 * so this can be used to tell if a particular movement has been replaced by another one.
+	 * @return The id of the most recently started movement.
+	 */
+	uint32_t get_move_id();
+
 	/**
 	 * Gets the wheel diameter of the drivetrain
 	 * @return The wheel diameter of the drivetrain.
 	 */
 	double get_wheel_diameter() const;
 
+	/**
+	 * Gets the status of the most recent movement.
+	 * @return MoveStatus::Moving if the movement is still in progress, otherwise the reason that it ended.
+	 */
+	MoveStatus get_move_status();
+
 	// Setters
+	//
+	// Setters never wait on the tracking loop. Each one publishes a new version of the config, which the tracking loop
+	// picks up all at once at the start of its next tick, so a tick never runs with a partially updated config.
+
+	/**
+	 * Replaces every value in the drivetrain's config at once.
+	 * @param config The new config.
+	 */
+	void set_config(const Config& config);
 
 	/**
 	 * Sets the minimum acceptable error threshold for the drive PID controller to consider its movements settled.
@@ -274,6 +439,12 @@ public:
 	 * @param gains A PIDController::Gains structure containing the new proportional, integral and derivative gain constants.
 	 */
 	void set_turn_gains(const PIDController::Gains& gains);
+
+	/**
+	 * Sets the gain constants for the inner velocity PID controllers.
+	 * @param gains A PIDController::Gains structure containing the new proportional, integral and derivative gain constants.
+	 */
+	void set_velocity_gains(const PIDController::Gains& gains);
 	
 	/**
 	 * Gets the current gear external ratio of the drivetrain.
@@ -295,12 +466,146 @@ public:
 	 */
 	void set_max_turn_power(double power);
 
+	/**
+	 * Sets the maximum linear velocity of each side of the drivetrain used by the inner velocity loop.
+	 * @param velocity The new maximum wheel velocity in distance units per second. Setting this to 0 disables the velocity loop.
+	 */
+	void set_max_velocity(double velocity);
+
+	/**
+	 * Sets the feedforward constants used by the inner velocity loop.
+	 * @param left_gains The new feedforward constants for the left side of the drivetrain.
+	 * @param right_gains The new feedforward constants for the right side of the drivetrain.
+	 */
+	void set_feedforward_gains(const Feedforward::Gains& left_gains, const Feedforward::Gains& right_gains);
+
 	/**
 	 * Gets the wheel diameter of the drivetrain
 	 * @return The wheel diameter of the drivetrain.
 	 */
 	void set_wheel_diameter(double diameter);
 
+	// Flight recorder
+
+	/**
+	 * Starts recording every tick of the tracking loop (sensor readings, pose, targets, errors, controller
+	 * outputs, voltages and loop timing) into a preallocated flight recorder.
+	 *
+	 * The recorder keeps the most recent `capacity` ticks. Ticks are 5ms apart, so the default capacity holds
+	 * roughly the last 20 seconds, using around 1MB of memory.
+	 *
+	 * @param capacity The number of ticks to keep.
+	 * @param dump_path If not empty, the recording is automatically written to this file on the SD card when a
+	 * movement is aborted (once the movement function returns) and when tracking stops.
+	 */
+	void start_recording(std::size_t capacity = 4096, const std::string& dump_path = "");
+
+	/** Stops recording and frees the flight recorder. */
+	void stop_recording();
+
+	/**
+	 * Writes the flight recorder's history to a CSV file on the SD card.
+	 * The ticks recorded so far are written, while the tracking loop keeps running and recording.
+	 * @param path The path of the file, relative to the root of the SD card.
+	 * @return True if the file was written, false otherwise (such as if recording hasn't been started, or no SD card is inserted).
+	 */
+	bool dump_recording(const std::string& path);
+
+	// Replay
+
+	/**
+	 * Prepares the drivetrain to replay a flight recording, restoring the state left by a recorded tick.
+	 *
+	 * While replaying, ticks of the tracking loop are run on demand by replay_tick() using recorded sensor readings
+	 * and commands, as fast as they can be computed. No devices are accessed (sensors aren't read, motors aren't spun,
+	 * and motor temperature and current aren't reported), so this can run on a computer (see tools/replay.cpp) to
+	 * check odometry or controller changes against real runs.
+	 *
+	 * @attention Tracking must be stopped.
+	 * @param record The record to start from, which must be from a tick that odometry and the controllers ran on
+	 * (every other tick). Replay continues from the tick after it. This can also be called while replaying, to start
+	 * again after a gap in the recording.
+	 * @return True if the replay was started, false otherwise (which also stops a replay in progress).
+	 */
+	bool begin_replay(const FlightRecorder::Record& record);
+
+	/**
+	 * Runs a single tick of the tracking loop from a recorded tick's inputs.
+	 * @param input The recorded tick. Its sensor readings and commands are used as the tick's inputs.
+	 * @param output Set to the record produced by the replayed tick, which can be compared against `input`.
+	 * @return True if the tick was replayed. False if begin_replay() hasn't been called, or if `input` isn't the tick
+	 * after the previous one (such as after a gap in the recording), in which case begin_replay() has to be called again.
+	 */
+	bool replay_tick(const FlightRecorder::Record& input, FlightRecorder::Record& output);
+
+	/** Stops replaying, allowing tracking to be started again. */
+	void end_replay();
+
+	// Telemetry
+
+	/**
+	 * Subscribes a sink to the drivetrain's telemetry.
+	 * Sinks receive data on each channel at that channel's rate (see set_telemetry_period()) while tracking is active.
+	 * @attention The sink is referenced rather than copied, so it must stay alive until it is unsubscribed.
+	 * @param sink The sink to subscribe.
+	 */
+	void subscribe_telemetry(telemetry::Sink& sink);
+
+	/**
+	 * Unsubscribes a sink from the drivetrain's telemetry.
+	 * @param sink The sink to unsubscribe.
+	 */
+	void unsubscribe_telemetry(telemetry::Sink& sink);
+
+	/**
+	 * Sets how often a telemetry channel is published.
+	 * @note Telemetry is published by the tracking thread every 10ms, so periods are effectively rounded up to a multiple of 10ms.
+	 * @param channel The channel to change.
+	 * @param period The time between each publish in milliseconds. A period of 0 disables the channel.
+	 */
+	void set_telemetry_period(telemetry::Channel channel, uint32_t period);
+
+	// Move metrics
+
+	/**
+	 * Gets the metrics of every movement that has ended since tracking started, oldest first.
+	 * Only the most recent 64 movements are kept.
+	 * @return The metrics of each movement.
+	 */
+	std::vector<MoveMetrics> get_move_history();
+
+	/** Removes every movement from the history. */
+	void clear_move_history();
+
+	/**
+	 * Logs the move history as a table at the INFO level, for comparing movements while tuning.
+	 */
+	void log_move_history();
+
+	/**
+	 * Gets a readable name for a move status.
+	 * @param status The status to name.
+	 * @return The name of the status, such as "settled".
+	 */
+	static const char* move_status_to_string(MoveStatus status);
+
+	// Profiling
+
+	/**
+	 * Gets timing stats for part of the tracking loop, measured since tracking started (or reset_timing() was called).
+	 *
+	 * Every stage is counted as an overrun if it takes longer than a full tick (5ms), and a tick is counted as waking
+	 * up late if it starts more than 1ms after it was scheduled. Stats are all zero if profiling was compiled out
+	 * (by defining `TAO_PROFILING=0`).
+	 *
+	 * @param stage The part of the loop to get stats for.
+	 * @return Durations in microseconds, along with the number of overruns.
+	 */
+	profiling::Histogram::Stats get_timing(TimingStage stage);
+
+	/** Clears every timing histogram. */
+	void reset_timing();
+
 	// Lifecycle functions
 
 	/**
@@ -322,20 +627,54 @@ public:
 
 	/**
 	 * Calibrates the inertial sensor associated with this drivetrain, if available.
-	 * Assuming an imu is available and installed, this function will block for up to
+	 * Assuming an imu is available and installed, a blocking calibration will block for up to
 	 * 3600ms (3.6 seconds).
 	 * 
+	 * Calibration can instead be started in the background by passing `blocking = false`, which returns
+	 * immediately. Tracking can be started before a background calibration finishes, in which case heading
+	 * is calculated from the wheels until the imu is ready, then switches over to the imu without a jump.
+	 * 
 	 * This function should be called while the robot is entirely stationary, ideally
-	 * before the autonomous period starts. Physical disturbances or vibration during
+	 * before the autonomous period starts (such as in pre-auton). Physical disturbances or vibration during
 	 * calibration may cause the sensor to drift. 
+	 * 
+	 * @param blocking Determines if the function should block the current thread until calibration is finished.
 	 */
-	void calibrate_imu();
+	void calibrate_imu(bool blocking = true);
+
+	/**
+	 * Indicates if the imu has finished calibrating.
+	 * @return True if an imu is available and has been calibrated, false otherwise.
+	 */
+	bool is_imu_calibrated();
+
+	/** Blocks the current thread until a calibration started by calibrate_imu() has finished. */
+	void wait_until_imu_calibrated();
+
+	/**
+	 * Measures the drivetrain's feedforward constants and effective track width.
+	 * 
+	 * This runs a quasistatic voltage ramp and a dynamic voltage step in each direction, fitting
+	 * kS, kV and kA for each side using least squares, followed by a spin-in-place test that compares
+	 * the imu's rotation with the difference in wheel travel to find the effective track width.
+	 * 
+	 * @attention The robot will drive forwards and backwards, then spin in place. Ensure it has room to move,
+	 * and that tracking is stopped. If no imu is available, the track width will not be measured.
+	 * 
+	 * @param ramp_rate The rate in volts per second that the quasistatic test increases voltage at.
+	 * @param step_voltage The voltage applied by the dynamic test.
+	 * @param duration The length of each test in seconds.
+	 * @return The current config, with the measured feedforward constants, track width and maximum velocity filled in.
+	 */
+	Config characterize(double ramp_rate = 1.0, double step_voltage = 6.0, double duration = 3.0);
 
 	/**
 	 * Blocks the current thread until the drivetrain is settled, or until a timeout is exceeded. 
 	 * @param timeout The maximum amount of time to block the current thread in milliseconds, regardless of if the drivetrain settles or not.
+	 * A timeout of 0 waits indefinitely.
+	 * @return True if the drivetrain settled, false if the timeout was exceeded.
 	 */
-	void wait_until_settled();
+	bool wait_until_settled(uint32_t timeout = 0);
 
 	// Movement functions
 
@@ -369,9 +708,11 @@ public:
 	
 	/**
 	 * Moves the drivetrain along a set of path waypoints.
+	 * The lookahead point is updated by the tracking thread, so the path is followed even if this function doesn't block.
 	 * @param path A vector of 2D vectors representing waypoints forming a path..
+	 * @param blocking Determines if the function should block the current thread until the end of the path is reached and the drivetrain has settled.
 	*/
-	void follow_path(std::vector<Vector2> path);
+	void follow_path(std::vector<Vector2> path, bool blocking = true);
 
 	/**
 	 * Stops and holds the drivetrain at its current position and heading.
@@ -384,6 +725,38 @@ private:
 		Point
 	};
 
+	// Periods (in milliseconds) of each stage run by the tracking thread.
+	// Integrated motor encoders only report at 100hz (once every 10ms), so odometry and the outer position loop run at this rate.
+	// The inner velocity loop and motor output run twice as fast, so that disturbances (load, friction, battery sag) can be
+	// rejected before they have a chance to show up as position error.
+	static constexpr uint32_t SENSOR_PERIOD = 5;
+	static constexpr uint32_t ODOMETRY_PERIOD = 10;
+	static constexpr uint32_t PATH_PERIOD = 10;
+	static constexpr uint32_t CONTROL_PERIOD = 10;
+	static constexpr uint32_t VELOCITY_PERIOD = 5;
+	static constexpr uint32_t OUTPUT_PERIOD = 5;
+	static constexpr uint32_t SETTLE_PERIOD = 10;
+
+	static constexpr uint32_t FAULT_PERIOD = 10;
+	static constexpr uint32_t DIAGNOSTICS_PERIOD = 50;
+
+	// Telemetry is published at the rate of the position loop, so every controller update can be seen.
+	// Each telemetry channel is further decimated to its own rate by the publisher.
+	static constexpr uint32_t TELEMETRY_PERIOD = 10;
+	static constexpr uint32_t STATUS_PERIOD = 1000;
+
+	// Amount of time (in milliseconds) that both errors must stay within tolerance for the drivetrain to be considered settled.
+	static constexpr uint32_t SETTLE_TIME = 50;
+
+	// The output voltage above which a side of the drivetrain is considered to be commanded to move during stall detection.
+	static constexpr double STALL_VOLTAGE = 3.0;
+
+	// The rate (in volts per second) that motor voltage is ramped down at after a movement is aborted.
+	static constexpr double ABORT_RAMP_RATE = 60.0;
+
+	// The motor temperature (in celsius) at which a warning is reported. V5 motors begin limiting current at 55C.
+	static constexpr double TEMPERATURE_WARNING = 50.0;
+
 	env::MotorGroup &left_motors, &right_motors;
 	env::Encoder *left_encoder, *right_encoder;
 	env::IMU* imu;
@@ -405,23 +778,164 @@ private:
 	double wheel_diameter;
 	double gearing;
 
+	double max_velocity;
+	double left_velocity_setpoint = 0.0, right_velocity_setpoint = 0.0;
+	double left_acceleration_setpoint = 0.0, right_acceleration_setpoint = 0.0;
+	double left_voltage = 0.0, right_voltage = 0.0;
+
+	double drive_power = 0.0, turn_power = 0.0;
+
+	// Sensor readings taken at the start of the current tick, which every other stage works from.
+	SensorFrame sensors = {};
+
+	double heading = 0.0, forward_travel = 0.0;
+	double previous_heading = 0.0, previous_forward_travel = 0.0;
+
+	// Counter representing the amount of settle stage cycles that each PID position has been within it's respective min error range.
+	int32_t settle_counter = 0;
+
 	bool settled = false;
+	MoveStatus move_status = MoveStatus::Settled;
+
+	// The path being followed, the index of the waypoint at the start of the current segment, and the movement that
+	// is following it. The path is abandoned once that movement ends or is replaced.
+	std::vector<Vector2> path;
+	std::size_t path_index = 0;
+	uint32_t path_move_id = 0;
+	bool following_path = false;
+
+	// The lookahead point that the path stage aimed for during the current tick, if any. The path itself isn't
+	// recorded, so a replay aims for the recorded lookahead point instead of following the path again.
+	Vector2 path_target;
+	bool path_target_set = false;
+
+	// Metrics of the current movement, and a ring of the movements that have ended. The sign of each error at the
+	// start of the movement determines which direction counts as overshooting. The movement's id identifies its span
+	// in the trace.
+	static constexpr std::size_t MOVE_HISTORY_SIZE = 64;
+	MoveMetrics current_move = {};
+	double initial_drive_error_sign = 0.0, initial_turn_error_sign = 0.0;
+	bool move_errors_measured = false;
+	uint32_t move_id = 0;
+	MoveMetrics move_history[MOVE_HISTORY_SIZE];
+	std::size_t move_history_count = 0;
+
+	uint32_t stall_time;
+	double stall_velocity;
+	double collision_acceleration;
+	uint32_t stall_timer = 0;
+	bool temperature_warned = false;
+
+	// Indicates if the current movement was aborted, in which case motor output is ramped down to zero until the next movement starts.
+	bool aborted = false;
+	double left_output_voltage = 0.0, right_output_voltage = 0.0;
 	bool imu_calibrated = false;
+	bool imu_calibrating = false;
 	bool imu_invalid = false;
 
+	// Indicates if the imu is currently being used for heading, and the offset applied to its readings. The
+	// offset allows tracking to switch from wheel heading to the imu partway through the tracking period.
+	bool imu_active = false;
+	double imu_heading_offset = 0.0;
+
 	PIDController drive_controller, turn_controller;
+	PIDController left_velocity_controller, right_velocity_controller;
+	Feedforward left_feedforward, right_feedforward;
 	Logger logger;
 
+	// Everything that can be changed by a setter. Setters publish a new copy through the seqlock (taking
+	// config_mutex only to serialize each other), and the tracking loop copies it into the fields above once
+	// the version changes. Getters read the published copy, so they reflect a change straight away.
+	struct Tunables {
+		Config config;
+		double max_drive_power, max_turn_power;
+	};
+
+	threading::SeqLock<Tunables> config_snapshot;
+	env::Mutex config_mutex;
+	uint32_t applied_config_version = 0;
+
+	// Writes the state channel to the logger as binary frames while the logger is at the TELEMETRY level.
+	class FrameSink : public telemetry::Sink {
+	public:
+		FrameSink(Logger logger) : logger(logger) {}
+
+		void on_state(const telemetry::Sample& sample) override;
+
+		void reset() { encoder.reset(); }
+
+	private:
+		Logger logger;
+		telemetry::FrameEncoder encoder;
+	};
+
+	// Flight recorder state. A dump is requested by the tracking thread when a movement is aborted, but is
+	// written by the thread that was waiting on the movement, since SD card writes would stall the loop.
+	std::shared_ptr<FlightRecorder> recorder;
+	std::string recording_path;
+	bool recording_dump_pending = false;
+
+	// Indicates if ticks are being replayed, in which case sensors aren't read and motors aren't spun.
+	bool replaying = false;
+	std::shared_ptr<RateScheduler> replay_scheduler;
+
+	telemetry::Publisher telemetry_publisher;
+	FrameSink frame_sink{ logger };
+	env::Timer tracking_timer;
+
+	// Timing histogram for each TimingStage, in the same order.
+	static constexpr std::size_t TIMING_STAGE_COUNT = static_cast<std::size_t>(TimingStage::Wakeup) + 1;
+	profiling::Histogram timings[TIMING_STAGE_COUNT];
+
+	// Ticks that start more than this many microseconds after they were scheduled count as late wakeups.
+	static constexpr uint32_t WAKEUP_BUDGET = 1000;
+
 	void set_target(Vector2 position);
 	void set_target(double distance, double heading);
 
+	void begin_move(const char* name);
+	void abort_move(MoveStatus status);
+	void end_move(MoveStatus status);
+
+	void lock_mutex();
+
+	template <typename Modify>
+	void update_config(Modify modify);
+	void apply_config();
+
 	int tracking();
-	int logging();
+	int imu_calibration();
+
+	double get_wheel_heading() const;
+	double calculate_wheel_heading(double left_travel, double right_travel) const;
+	bool is_imu_ready();
+
+	void update_sensors(double dt);
+	void update_odometry(double dt);
+	void update_path(double dt);
+	void update_control(double dt);
+	void update_velocity(double dt);
+	void update_output(double dt);
+	void update_settle(double dt);
+	void update_faults(double dt);
+	void update_diagnostics(double dt);
+	void update_telemetry(double dt);
+	void update_status(double dt);
+
+	void add_tracking_stages(RateScheduler& scheduler);
+	profiling::Histogram& timing(TimingStage stage) { return timings[static_cast<std::size_t>(stage)]; }
+
+	void record_inputs(FlightRecorder::Record& record, uint64_t tick) const;
+	void record_outputs(FlightRecorder::Record& record) const;
+	void apply_recorded_commands(const FlightRecorder::Record& record);
+	void dump_pending_recording();
+
+	void run_characterization_test(double direction, double ramp_rate, double step_voltage, double duration,
+		Feedforward::Regression& left_regression, Feedforward::Regression& right_regression);
 	
 	bool tracking_active = false;
-	bool logging_active = false;
 
-	std::shared_ptr<env::Thread> tracking_thread, logging_thread;
+	std::shared_ptr<env::Thread> tracking_thread, calibration_thread;
 	env::Mutex mutex;
 };
 
@@ -0,0 +1,93 @@
+/**
+ * @file src/taolib/Feedforward.h
+ * @author Tropical
+ *
+ * Open-loop voltage model for a DC motor driven mechanism.
+ */
+
+#pragma once
+
+namespace tao {
+
+/**
+ * A feedforward model that estimates the voltage needed to reach a given velocity and acceleration.
+ * The model follows the standard permanent-magnet DC motor equation: V = kS * sign(v) + kV * v + kA * a
+ */
+class Feedforward {
+public:
+	/**
+	 * A structure containing the constants of a feedforward model.
+	 * These can be measured automatically using DifferentialDrivetrain::characterize.
+	 */
+	typedef struct {
+		/** The voltage required to overcome static friction. */
+		double kS;
+
+		/** The voltage required to hold a velocity of one distance unit per second. */
+		double kV;
+
+		/** The voltage required to accelerate at one distance unit per second squared. */
+		double kA;
+	} Gains;
+
+	/**
+	 * Fits feedforward gains to a set of (voltage, velocity, acceleration) samples using ordinary least squares.
+	 * Samples are accumulated into the normal equations as they are added, so no sample history is stored.
+	 */
+	class Regression {
+	public:
+		Regression();
+
+		/**
+		 * Adds a measurement to the regression.
+		 * @param voltage The voltage that was applied to the mechanism.
+		 * @param velocity The measured velocity of the mechanism.
+		 * @param acceleration The measured acceleration of the mechanism.
+		 */
+		void add_sample(double voltage, double velocity, double acceleration);
+
+		/**
+		 * Gets the number of samples that have been added to the regression.
+		 * @return The current sample count.
+		 */
+		int get_sample_count() const;
+
+		/**
+		 * Solves for the gains that best fit every sample added so far.
+		 * @return The fitted gains, or zeroed gains if the samples don't contain enough information (for example, if the mechanism never accelerated).
+		 */
+		Gains solve() const;
+
+	private:
+		// Accumulated normal equations (XᵀX and Xᵀy) for the regressors [sign(v), v, a].
+		double xtx[3][3];
+		double xty[3];
+		int sample_count;
+	};
+
+	// Constructor(s)
+	Feedforward();
+	Feedforward(Gains gains);
+
+	/**
+	 * Calculates the voltage required to reach a given velocity and acceleration.
+	 * @param velocity The desired velocity in distance units per second.
+	 * @param acceleration The desired acceleration in distance units per second squared.
+	 * @return The estimated voltage.
+	 */
+	double calculate(double velocity, double acceleration = 0.0) const;
+
+	/**
+	 * Indicates if the model has been configured with a non-zero velocity constant.
+	 * @return True if the model can be used to calculate voltages, false otherwise.
+	 */
+	bool is_configured() const;
+
+	Gains get_gains() const;
+	void set_gains(const Gains& gains);
+
+private:
+	Gains gains;
+};
+
+} // namespace tao
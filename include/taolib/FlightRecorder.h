@@ -0,0 +1,172 @@
+/**
+ * @file src/taolib/FlightRecorder.h
+ * @author Tropical
+ *
+ * Fixed-size history of every tracking loop tick, for diagnosing movements after a run.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+#include "SensorFrame.h"
+
+namespace tao {
+
+/**
+ * Records every tick of the tracking loop into a preallocated ring buffer, keeping the most recent history.
+ *
+ * Recording a tick is a single struct copy, so the recorder can run at full rate without affecting
+ * the loop. The history can then be written to a CSV file (on the brain's SD card), and recording carries on
+ * while the file is written.
+ */
+class FlightRecorder {
+public:
+	/**
+	 * The state of the drivetrain during a single tick.
+	 *
+	 * A record holds every input to the tick (sensor readings and the commands given by movement functions)
+	 * along with the state it produced, so ticks can be replayed and compared (see DifferentialDrivetrain::replay_tick).
+	 */
+	struct Record {
+		/** Number of the tick since the tracking period started. */
+		uint32_t tick;
+
+		/** Raw sensor readings used by the tick. */
+		SensorFrame sensors;
+
+		/** Type of target at the start of the tick (0 for a distance and heading, 1 for a point). */
+		uint8_t target_type;
+
+		/** Target position (when moving to a point), or target distance and heading, at the start of the tick. */
+		double target_x, target_y, target_distance, target_heading;
+
+		/** Power limits of the drive and turn controllers at the start of the tick. */
+		double max_drive_power, max_turn_power;
+
+		/** Status of the current movement at the start of the tick, as a DifferentialDrivetrain::MoveStatus. */
+		uint8_t move_status;
+
+		/** Set to 1 if the path stage aimed for a new lookahead point during the tick (while following a path), or 0 otherwise. */
+		uint8_t path_target_set;
+
+		/** The lookahead point that the path stage aimed for, if `path_target_set` is 1. */
+		double path_target_x, path_target_y;
+
+		/** Global position and heading of the drivetrain. */
+		double x, y, heading;
+
+		/** Errors of the drive and turn controllers. */
+		double drive_error, turn_error;
+
+		/** Outputs of the drive and turn controllers as a percentage. */
+		double drive_power, turn_power;
+
+		/** Velocity setpoints of each side of the drivetrain (only used by the velocity loop). */
+		double left_velocity_setpoint, right_velocity_setpoint;
+
+		/** Voltage applied to each side of the drivetrain. */
+		double left_voltage, right_voltage;
+
+		/** Accumulated integrals of the drive, turn and velocity controllers, so a replay can start from any tick. */
+		double drive_integral, turn_integral, left_velocity_integral, right_velocity_integral;
+
+		/** Time in microseconds since the previous tick started, and time spent running this tick. */
+		uint32_t tick_interval, tick_duration;
+	};
+
+	/**
+	 * The records that were held at a point in time, which can be written with dump() while recording continues.
+	 */
+	struct Snapshot {
+		/** Sequence number of the oldest record, counting every record since the recorder was created. */
+		uint32_t first;
+
+		/** Index of the oldest record in the buffer. */
+		std::size_t start;
+
+		/** Number of records. */
+		std::size_t count;
+	};
+
+	/**
+	 * Creates a new recorder, allocating all of its storage up front.
+	 * @param capacity The number of ticks that are kept. Older ticks are overwritten once the recorder is full.
+	 */
+	FlightRecorder(std::size_t capacity);
+
+	/**
+	 * Records a tick, overwriting the oldest record if the recorder is full.
+	 * Records are ignored while the recorder is frozen.
+	 * @param record The record to add.
+	 */
+	void record(const Record& record);
+
+	/**
+	 * Gets a record.
+	 * @param index The index of the record, where 0 is the oldest.
+	 * @return The record at the given index.
+	 */
+	const Record& get(std::size_t index) const;
+
+	std::size_t size() const;
+
+	std::size_t capacity() const;
+
+	/** Removes every record. */
+	void clear();
+
+	/**
+	 * Stops or resumes recording, such as to keep the history leading up to an event.
+	 * @param frozen Determines if new records are ignored.
+	 */
+	void set_frozen(bool frozen);
+
+	bool is_frozen() const;
+
+	/**
+	 * Takes a snapshot of the records currently held, to be written by dump().
+	 * @attention Must not be called while a record is being added, so it should be called under the same lock as record().
+	 */
+	Snapshot snapshot() const;
+
+	/**
+	 * Writes the records in a snapshot to a CSV file, oldest first.
+	 *
+	 * Rows are formatted into a fixed buffer and written in chunks, so dumping doesn't allocate. Records can keep being
+	 * added from another thread while the file is written. If recording wraps around and overwrites records before
+	 * they're written, the dump skips ahead to the oldest record that's left, leaving a gap in the ticks.
+	 *
+	 * @param path The path of the file, relative to the root of the SD card.
+	 * @param snapshot The records to write, from snapshot().
+	 * @param preamble Optional text written before the CSV header, such as the drivetrain's config. Each line should start with `#`.
+	 * @param dumped If not null, set to the number of records written, which is less than the snapshot's count if some were overwritten.
+	 * @return True if the file was written, false otherwise.
+	 */
+	bool dump(const char* path, const Snapshot& snapshot, const char* preamble = nullptr, std::size_t* dumped = nullptr) const;
+
+	/**
+	 * Parses a row written by dump().
+	 * @param row A single line of CSV, not including the header.
+	 * @param record Set to the parsed record.
+	 * @return True if the row was parsed, false otherwise.
+	 */
+	static bool parse(const char* row, Record& record);
+
+private:
+	std::unique_ptr<Record[]> records;
+	std::size_t record_capacity;
+	std::size_t head;
+	std::size_t count;
+
+	// Number of records that have been started. It's bumped before a record is written, so a dump on another
+	// thread can tell if the record it just copied was being overwritten.
+	std::atomic<uint32_t> sequence;
+
+	bool frozen;
+};
+
+} // namespace tao
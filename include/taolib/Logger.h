@@ -4,8 +4,44 @@
 #include <fstream>
 #include <string>
 #include <cstdarg>
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <vector>
+#include <type_traits>
+
+// Numeric values of each Logger::Level, for use in preprocessor conditions.
+#define TAO_LOG_LEVEL_TELEMETRY 0
+#define TAO_LOG_LEVEL_DEBUG 1
+#define TAO_LOG_LEVEL_INFO 2
+#define TAO_LOG_LEVEL_WARNING 3
+#define TAO_LOG_LEVEL_ERROR 4
+#define TAO_LOG_LEVEL_FATAL 5
+
+/**
+ * The minimum level of messages compiled into the program.
+ * Logging macros below this level are removed entirely, along with the evaluation of their arguments.
+ * For example, competition builds can define `TAO_LOG_MIN_LEVEL=TAO_LOG_LEVEL_INFO` to strip all debug logging.
+ */
+#ifndef TAO_LOG_MIN_LEVEL
+#define TAO_LOG_MIN_LEVEL TAO_LOG_LEVEL_TELEMETRY
+#endif
+
+#ifndef DOXYGEN_IGNORE
+// Logs a message if its level is both compiled in and enabled at runtime. Arguments are only evaluated
+// if the message will actually be logged. Disabled levels still type-check their arguments, but compile to nothing.
+#define TAO_LOG_IF_(compiled, logger, level, method, ...) \
+	do { \
+		if ((compiled) && (logger).is_enabled(::tao::Logger::Level::level)) (logger).method(__VA_ARGS__); \
+	} while (0)
+#endif /* DOXYGEN_IGNORE */
+
+#define TAO_LOG_TELEMETRY(logger, ...) TAO_LOG_IF_(TAO_LOG_MIN_LEVEL <= TAO_LOG_LEVEL_TELEMETRY, logger, TELEMETRY, telemetry, __VA_ARGS__)
+#define TAO_LOG_DEBUG(logger, ...) TAO_LOG_IF_(TAO_LOG_MIN_LEVEL <= TAO_LOG_LEVEL_DEBUG, logger, DEBUG, debug, __VA_ARGS__)
+#define TAO_LOG_INFO(logger, ...) TAO_LOG_IF_(TAO_LOG_MIN_LEVEL <= TAO_LOG_LEVEL_INFO, logger, INFO, info, __VA_ARGS__)
+#define TAO_LOG_WARNING(logger, ...) TAO_LOG_IF_(TAO_LOG_MIN_LEVEL <= TAO_LOG_LEVEL_WARNING, logger, WARNING, warning, __VA_ARGS__)
+#define TAO_LOG_ERROR(logger, ...) TAO_LOG_IF_(TAO_LOG_MIN_LEVEL <= TAO_LOG_LEVEL_ERROR, logger, ERROR, error, __VA_ARGS__)
+#define TAO_LOG_FATAL(logger, ...) TAO_LOG_IF_(TAO_LOG_MIN_LEVEL <= TAO_LOG_LEVEL_FATAL, logger, FATAL, fatal, __VA_ARGS__)
 
 namespace tao {
 
@@ -20,14 +56,111 @@ public:
 		FATAL
 	};
 
-	using Handle = std::function<void(Level, const std::string&)>;
+	/**
+	 * Determines what happens when a message is logged while the asynchronous queue is full.
+	 */
+	enum class OverflowPolicy {
+		/** Discard the oldest queued message to make room for the new one. */
+		DropOldest,
 
+		/** Discard the message being logged. */
+		DropNewest,
+
+		/** Block the logging thread until the drain thread makes room. */
+		Block
+	};
+
+	/**
+	 * A non-owning view of a formatted log message.
+	 * @note The message is only valid for the duration of the handle call, and is not null-terminated.
+	 */
+	struct Message {
+		/** The characters of the message. */
+		const char* data;
+
+		/** The number of characters in the message. */
+		std::size_t size;
+	};
+
+	/**
+	 * A lightweight reference to a function or object that receives log messages.
+	 * Calling a handle never allocates, so messages can be delivered from time-critical threads.
+	 */
+	class Handle {
+	public:
+		/**
+		 * Creates a handle that calls a function.
+		 * @param function The function to call with each message.
+		 */
+		Handle(void (*function)(Level, Message))
+			: object(nullptr), function(function), invoke(&invoke_function) {}
+
+		/**
+		 * Creates a handle that calls an object's `operator()(Level, Message)`.
+		 * @attention The object is referenced rather than copied, so it must outlive the logger.
+		 * @param object The object to call with each message.
+		 */
+		template <typename T, typename = typename std::enable_if<!std::is_same<typename std::decay<T>::type, Handle>::value>::type>
+		Handle(T& object)
+			: object(&object), function(nullptr), invoke(&invoke_object<T>) {}
+
+		void operator()(Level level, Message message) const { invoke(*this, level, message); }
+
+	private:
+		void* object;
+		void (*function)(Level, Message);
+		void (*invoke)(const Handle&, Level, Message);
+
+		static void invoke_function(const Handle& handle, Level level, Message message) {
+			handle.function(level, message);
+		}
+
+		template <typename T>
+		static void invoke_object(const Handle& handle, Level level, Message message) {
+			(*static_cast<T*>(handle.object))(level, message);
+		}
+	};
+
+	/**
+	 * Constructs a new Logger.
+	 * @note Copies of a Logger share the same output, level, handles, and asynchronous queue.
+	 */
 	Logger(std::ostream& output_stream = std::cout, Level level = Level::INFO);
-	
+
 	void set_level(Level level);
 
+	/**
+	 * Indicates if messages of a given level will be logged, taking both the runtime level and TAO_LOG_MIN_LEVEL into account.
+	 * @param level The level to check.
+	 * @return True if messages of this level will be logged, false otherwise.
+	 */
+	bool is_enabled(Level level) const;
+
 	void add_handle(const Handle& handle);
 
+	/**
+	 * Adds a function (such as a captureless lambda) as a handle.
+	 * @param function The function to call with each message.
+	 */
+	void add_handle(void (*function)(Level, Message));
+
+	/**
+	 * Starts logging asynchronously.
+	 *
+	 * Messages are formatted into a fixed-size record and pushed onto a lock-free queue by the
+	 * logging thread, then written to the output stream and handles by a low-priority drain thread.
+	 * This keeps slow serial output from ever stalling the caller.
+	 *
+	 * @note Handles are called from the drain thread while logging asynchronously.
+	 *
+	 * @param capacity The number of messages that can be queued at once. Rounded up to a power of two.
+	 * @param policy Determines what happens when a message is logged while the queue is full.
+	 */
+	void start_async(std::size_t capacity = 64, OverflowPolicy policy = OverflowPolicy::DropOldest);
+
+	/** Writes out every queued message, then stops the drain thread and returns to logging synchronously. */
+	void stop_async();
+
 	void telemetry(const char* format, ...) const;
 
 	void debug(const char* format, ...) const;
@@ -40,18 +173,30 @@ public:
 
 	void fatal(const char* format, ...) const;
 
+	/**
+	 * Writes raw bytes (such as binary telemetry frames) to the output stream without any formatting.
+	 * Data is written at the TELEMETRY level, and is not passed to handles.
+	 * @note While logging asynchronously, data longer than MESSAGE_SIZE is dropped rather than split.
+	 * @param data The bytes to write.
+	 * @param size The number of bytes to write.
+	 */
+	void write(const uint8_t* data, std::size_t size) const;
+
+	/**
+	 * The maximum length of a message (including the null terminator).
+	 * Messages are formatted into a fixed-size buffer rather than the heap, and longer messages are truncated.
+	 */
+	static constexpr std::size_t MESSAGE_SIZE = 256;
+
 private:
-	std::ostream& output_stream;
-	Level level;
-	std::vector<std::function<void(Level, const std::string&)>> handles;
-	
-	void log(Level level, const char* format, va_list args) const;
+	struct State;
+	std::shared_ptr<State> state;
 
-	static std::string level_to_string(Level level);
+	void log(Level level, const char* format, va_list args) const;
 
-	static std::string colorize(const std::string& message, Level level);
+	static const char* level_to_string(Level level);
 
-	static const std::string format(const char * const format, va_list args);
+	static const char* level_to_color(Level level);
 };
 
-} // namespace tao
\ No newline at end of file
+} // namespace tao
@@ -31,6 +31,21 @@ public:
 		double i_threshold;
 	} Gains;
 
+	/**
+	 * The individual components of the most recent controller output, already multiplied by their gains.
+	 * The output of update() is the sum of these terms.
+	 */
+	typedef struct {
+		/** The proportional term. */
+		double proportional;
+
+		/** The integral term. */
+		double integral;
+
+		/** The derivative term. */
+		double derivative;
+	} Terms;
+
 	// Constructor(s)
 	PIDController();
 	PIDController(Gains gains);
@@ -42,12 +57,22 @@ public:
 	Gains get_gains() const;
 	void set_gains(const Gains& gains);
 
+	// Get the terms that made up the most recent output.
+	Terms get_terms() const;
+
+	// Get or restore the accumulated integral and the error from the previous update.
+	double get_integral() const;
+	void restore(double previous_error, double integral);
+
 private:
 	// PID gains
 	Gains gains;
 
 	// Previous error and integral term
 	double previous_error, integral;
+
+	// Terms of the most recent output
+	Terms terms;
 };
 
 } // namespace tao
\ No newline at end of file
@@ -0,0 +1,118 @@
+/**
+ * @file src/taolib/PointBuffer.h
+ * @author Tropical
+ *
+ * Structure-of-arrays storage for paths and other lists of points, with vectorized geometry queries.
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "Vector2.h"
+
+/**
+ * Determines if PointBuffer queries use SIMD instructions (enabled by default).
+ * NEON is used on the brain, and SSE (or AVX, when compiled with it) on a computer. Defining `TAO_SIMD=0` forces the
+ * scalar fallback, which gives the same results.
+ */
+#ifndef TAO_SIMD
+#define TAO_SIMD 1
+#endif
+
+namespace tao {
+
+/**
+ * A list of points stored as separate arrays of x and y coordinates, so that queries across every point (or every
+ * segment between consecutive points) can process several of them per instruction.
+ *
+ * Coordinates are stored as floats, which the brain's NEON unit can work on four at a time. That's still far more
+ * precise than the robot's position is known, so results are returned as regular (double) vectors.
+ *
+ * Segment queries treat the buffer as a path, where segment i runs from point i to point i + 1.
+ */
+class PointBuffer {
+public:
+	/** The corners of an axis-aligned box. */
+	struct BoundingBox {
+		Vector2 min, max;
+	};
+
+	PointBuffer();
+
+	/**
+	 * Creates a buffer holding a copy of a list of points.
+	 * @param points The points to copy, such as a path passed to DifferentialDrivetrain::follow_path.
+	 */
+	PointBuffer(const std::vector<Vector2>& points);
+
+	/** Replaces the contents of the buffer with a copy of a list of points. */
+	void assign(const std::vector<Vector2>& points);
+
+	/** Adds a point to the end of the buffer. */
+	void push_back(Vector2 point);
+
+	/** Allocates room for a number of points up front, so that adding them doesn't allocate. */
+	void reserve(std::size_t capacity);
+
+	/** Removes every point, keeping the allocated storage. */
+	void clear();
+
+	/** @return The number of points in the buffer. */
+	std::size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	/** @return The point at an index. */
+	Vector2 operator[](std::size_t index) const { return Vector2(xs[index], ys[index]); }
+
+	/**
+	 * Calculates the squared distance from a point to every point in the buffer.
+	 * @param point The point to measure from.
+	 * @param distances Receives one squared distance for each point in the buffer (size() entries).
+	 */
+	void distances_squared(Vector2 point, float* distances) const;
+
+	/**
+	 * Finds the point in the buffer closest to another point. Ties go to the lowest index.
+	 * @param point The point to measure from.
+	 * @return The index of the closest point, or size() if the buffer is empty.
+	 */
+	std::size_t nearest_point(Vector2 point) const;
+
+	/**
+	 * Finds the segment closest to a point. Ties go to the lowest index.
+	 * @param point The point to measure from.
+	 * @param t If not null, receives how far along the segment (from 0 to 1) its closest point is.
+	 * @return The index of the closest segment, or size() if there are fewer than 2 points.
+	 */
+	std::size_t nearest_segment(Vector2 point, double* t = nullptr) const;
+
+	/**
+	 * Intersects every segment with a circle, such as the lookahead circle used for path following.
+	 * @param center The center of the circle.
+	 * @param radius The radius of the circle.
+	 * @param t Receives, for each segment (size() - 1 entries), how far along it (from 0 to 1) the intersection
+	 * furthest along the segment is, or -1 if the segment doesn't touch the circle.
+	 * @return The number of segments that intersect the circle.
+	 */
+	std::size_t intersect_circle(Vector2 center, double radius, float* t) const;
+
+	/**
+	 * Calculates the smallest axis-aligned box containing every point.
+	 * @return The box, which is empty (both corners at the origin) if the buffer is empty.
+	 */
+	BoundingBox bounding_box() const;
+
+private:
+	// Every query runs over whole groups of this many points, so storage always extends past the last point by at
+	// least this many copies of it. Copies of the last point never change a result, and don't need to be masked.
+	static constexpr std::size_t PADDING = 8;
+
+	void pad();
+
+	std::vector<float> xs, ys;
+	std::size_t count;
+};
+
+} // namespace tao
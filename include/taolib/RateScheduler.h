@@ -0,0 +1,103 @@
+/**
+ * @file src/taolib/RateScheduler.h
+ * @author Tropical
+ *
+ * Runs a set of periodic stages at independent rates from a single thread.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "env.h"
+
+namespace tao {
+
+/**
+ * A deterministic multi-rate scheduler for control loops.
+ *
+ * Each stage declares its own period, and the scheduler ticks at the greatest common divisor of
+ * every registered period. On each tick, every stage that is due runs in the order it was added,
+ * so fast stages are never held back by slow ones and slow stages don't run more often than needed.
+ */
+class RateScheduler {
+public:
+	/**
+	 * A function run by the scheduler.
+	 * The stage is passed its nominal time step in seconds (its period).
+	 */
+	using Stage = std::function<void(double)>;
+
+	RateScheduler();
+
+	/**
+	 * Registers a new stage with the scheduler.
+	 * @param period The period in milliseconds that the stage will run at.
+	 * @param stage The function to run every period.
+	 */
+	void add_stage(uint32_t period, const Stage& stage);
+
+	/**
+	 * Runs every stage that is due on the current tick, then advances to the next tick.
+	 * @note This does not sleep, which allows the scheduler to be stepped faster than real time.
+	 */
+	void tick();
+
+	/**
+	 * Blocks the current thread until the next tick is due.
+	 * Deadlines are tracked from when the scheduler was started (or reset), so time spent
+	 * running stages doesn't cause the schedule to drift.
+	 */
+	void wait();
+
+	/**
+	 * Restarts the schedule.
+	 * @param tick The tick to restart from. Stages are due on the same ticks as they would be if the scheduler had
+	 * been running since tick zero, which keeps them in phase when resuming a recorded run.
+	 */
+	void reset(uint64_t tick = 0);
+
+	/**
+	 * Gets the number of the next tick to run.
+	 * @return The number of ticks run since the scheduler started (or the tick it was reset to).
+	 */
+	uint64_t get_tick_count() const;
+
+	/**
+	 * Gets how far behind schedule the next tick is.
+	 * @return The time in microseconds since the next tick was due, or a negative number if it isn't due yet.
+	 */
+	int64_t get_lateness() const;
+
+	/**
+	 * Determines if a stage runs on a given tick.
+	 * @param period The period of the stage in milliseconds.
+	 * @param tick The number of the tick.
+	 * @return True if a stage with the given period is due on the tick, false otherwise.
+	 */
+	bool is_due(uint32_t period, uint64_t tick) const;
+
+	/**
+	 * Gets the period of the scheduler's base tick.
+	 * @return The base tick period in milliseconds.
+	 */
+	uint32_t get_tick_period() const;
+
+private:
+	struct Entry {
+		uint32_t period;
+		Stage stage;
+	};
+
+	std::vector<Entry> stages;
+
+	uint32_t tick_period = 0;
+	uint64_t ticks = 0;
+	uint64_t origin = 0;
+
+	env::Timer timer;
+};
+
+} // namespace tao
@@ -0,0 +1,41 @@
+/**
+ * @file src/taolib/SensorFrame.h
+ * @author Tropical
+ *
+ * Raw sensor readings consumed by a single tick of the tracking loop.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace tao {
+
+/**
+ * A snapshot of every sensor reading used by the tracking loop.
+ *
+ * Sensors are read once at the start of each tick, and every stage of the loop works from the
+ * same snapshot. This keeps stages consistent with each other, avoids reading the same device
+ * twice in one tick, and allows a tick's inputs to be recorded in full.
+ */
+struct SensorFrame {
+	/** Time in microseconds since the tracking period started. */
+	uint32_t timestamp;
+
+	/** Distance travelled by each side of the drivetrain. */
+	double left_travel, right_travel;
+
+	/** Velocity of each side of the drivetrain in distance units per second. */
+	double left_velocity, right_velocity;
+
+	/** Indicates if an imu is plugged in, and if it is calibrating. Both are false if the drivetrain has no imu. */
+	bool imu_installed, imu_calibrating;
+
+	/** Heading reported by the imu in degrees (clockwise, as reported by the device). */
+	double imu_heading;
+
+	/** Planar acceleration reported by the imu in g. */
+	double imu_acceleration_x, imu_acceleration_y;
+};
+
+} // namespace tao
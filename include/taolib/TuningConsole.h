@@ -0,0 +1,120 @@
+/**
+ * @file src/taolib/TuningConsole.h
+ * @author Tropical
+ *
+ * Command interpreter for tuning a drivetrain live over the serial connection.
+ */
+
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "env.h"
+#include "Logger.h"
+#include "DifferentialDrivetrain.h"
+
+namespace tao {
+
+/**
+ * Reads commands from the serial connection on a background thread, and applies them to a drivetrain while it runs.
+ *
+ * Commands can get and set gains, tolerances, the lookahead distance and power limits, and start test movements, so
+ * a drivetrain can be tuned from a terminal without rebuilding and uploading the program after every change. Each
+ * command is a single line, and replies are written through the logger. Send `help` for a list of commands.
+ */
+class TuningConsole {
+public:
+	/** The longest command that can be read, including the null terminator. Longer commands are ignored. */
+	static constexpr std::size_t LINE_SIZE = 128;
+
+	/**
+	 * Creates a console. Input isn't read until start() is called.
+	 * @param drivetrain The drivetrain to tune. Must outlive the console.
+	 * @param logger The logger that replies are written to.
+	 */
+	TuningConsole(DifferentialDrivetrain& drivetrain, Logger logger);
+	~TuningConsole();
+
+	TuningConsole(const TuningConsole&) = delete;
+	TuningConsole& operator=(const TuningConsole&) = delete;
+
+	/** Starts reading commands from the serial connection on a low priority thread. */
+	void start();
+
+	/** Stops reading commands, waiting for the current one to finish. */
+	void stop();
+
+	/**
+	 * Runs a single command, as if it had been read from the serial connection.
+	 * @param command The command line, such as `set drive_gains 3.2 0 0.15`.
+	 * @return True if the command was run, false if it wasn't recognized or its arguments were invalid.
+	 */
+	bool execute(const char* command);
+
+private:
+	// How often (in milliseconds) serial input is checked for new commands.
+	static constexpr uint32_t POLL_PERIOD = 20;
+
+	// The most words (command name and arguments) in a single command.
+	static constexpr std::size_t MAX_ARGUMENTS = 8;
+
+	// The most values taken by a single parameter.
+	static constexpr std::size_t MAX_VALUES = 4;
+
+	enum class Parameter {
+		DriveGains,
+		TurnGains,
+		VelocityGains,
+		DriveTolerance,
+		TurnTolerance,
+		LookaheadDistance,
+		MaxDrivePower,
+		MaxTurnPower,
+		MaxVelocity
+	};
+
+	struct ParameterInfo {
+		const char* name;
+		Parameter parameter;
+		std::size_t value_count;
+	};
+
+	static const ParameterInfo PARAMETERS[];
+
+	int run();
+
+	bool get(const char* name);
+	bool set(const char* name, char** arguments, std::size_t argument_count);
+	void log_parameter(const ParameterInfo& info);
+	void read_parameter(Parameter parameter, double* values);
+	void write_parameter(Parameter parameter, const double* values);
+
+	void watch_move();
+	void report_move();
+	void log_help();
+
+	static const ParameterInfo* find_parameter(const char* name);
+	static bool parse_number(const char* text, double& value);
+
+	DifferentialDrivetrain& drivetrain;
+	Logger logger;
+
+	// Serialize commands, so that execute() can be called from other threads while the console is running.
+	env::Mutex mutex;
+
+	char line[LINE_SIZE];
+	std::size_t line_length = 0;
+	bool line_overflowed = false;
+
+	// The test movement started by the last command, which is reported once it ends.
+	bool watching_move = false;
+	uint32_t watched_move_id = 0;
+
+	std::atomic<bool> active;
+	std::shared_ptr<env::Thread> thread;
+};
+
+} // namespace tao
@@ -3,158 +3,271 @@
  * @author Tropical
  *
  * Implementation for a 2-dimensional vector stored as cartesian coordinates.
+ *
+ * The vector is defined entirely in this header, so its operators can be inlined wherever they are used, and most of
+ * them can be evaluated at compile time.
  */
 
 #pragma once
 
+#include <cmath>
+
 namespace tao {
 
 /**
  * Class object to represent a vector within a 2 dimensional space
+ * @tparam T The type of each component, usually float or double (see Vector2f and Vector2).
 */
-class Vector2 {
+template <typename T>
+class BasicVector2 {
 public:
 	/**
-	 * Initializes the Vector2 class with preloaded x and y values
+	 * Initializes the vector with preloaded x and y values
 	 * @param x x value of the vector
 	 * @param y y value of the vector
 	*/
-	Vector2(double x, double y);
+	constexpr BasicVector2(T x, T y) : x(x), y(y) {}
 
 	/**
-	 * Initializes the Vector2 class with another vector
-	 * @param v The other vector
+	 * Initializes the vector with the default x and y values of 0.
 	*/
-	Vector2(const Vector2 &v);
+	constexpr BasicVector2() : x(0), y(0) {}
 
 	/**
-	 * Initializes the Vector2 class with the default x and y values of 0.
+	 * Converts a vector with a different component type, such as a Vector2f to a Vector2.
+	 * @param v The other vector
 	*/
-	Vector2();
+	template <typename U>
+	constexpr explicit BasicVector2(const BasicVector2<U>& v) : x(static_cast<T>(v.get_x())), y(static_cast<T>(v.get_y())) {}
 
 	/**
 	 * Returns the x value of the vector
 	*/
-	double get_x() const;
+	constexpr T get_x() const { return x; }
 
 	/**
 	 * Returns the y value of the vector
 	*/
-	double get_y() const;
+	constexpr T get_y() const { return y; }
 
 	/**
 	 * Returns the magnitude of the vector (the vector's length, or distance from the origin)
 	*/
-	double get_magnitude() const;
+	T get_magnitude() const { return std::sqrt(x * x + y * y); }
+
+	/**
+	 * Returns the squared magnitude of the vector. This avoids a square root, so it should be preferred when comparing
+	 * lengths against each other or against a squared distance.
+	*/
+	constexpr T get_magnitude_squared() const { return x * x + y * y; }
 
 	/**
 	 * Returns the angle of the vector
 	*/
-	double get_angle() const;
+	T get_angle() const { return std::atan2(y, x); }
 
 	/**
 	 * Normalize the vector (change the length of the vector to 1 while retaining the direction)
 	 * @return Normalized version of the vector
 	*/
-	Vector2 normalized() const;
+	BasicVector2 normalized() const { return *this / get_magnitude(); }
 
 	/**
 	 * Rotate the vector by a given angle in radians
-	 * 
+	 *
 	 * @param angle The angle by which the vector should be rotated
-	 * 
-	 * @return Normalized version of the vector
+	 *
+	 * @return Rotated version of the vector
+	*/
+	BasicVector2 rotated(T angle) const {
+		return rotated(std::sin(angle), std::cos(angle));
+	}
+
+	/**
+	 * Rotate the vector by an angle given as its sine and cosine, such as from math::sincos
+	 *
+	 * @param sin_angle The sine of the angle by which the vector should be rotated
+	 * @param cos_angle The cosine of the angle by which the vector should be rotated
+	 *
+	 * @return Rotated version of the vector
 	*/
-	Vector2 rotated(double angle) const;
+	constexpr BasicVector2 rotated(T sin_angle, T cos_angle) const {
+		return BasicVector2(
+			x * cos_angle - y * sin_angle,
+			x * sin_angle + y * cos_angle
+		);
+	}
 
 	/**
 	 * Calculate the dot product of two vetors.
-	 * @details The dot product is the product of the vector in the
-	 * same length.
+	 * @details The dot product is the product of the vectors' lengths and the cosine of the angle between them.
 	 *
 	 * @param other The other vector to perform the dot operation with.
 	 *
-	 * @return Vector result of the dot operation.
+	 * @return Scalar result of the dot operation.
 	 */
-	double dot(const Vector2& other) const;
-	
+	constexpr T dot(const BasicVector2& other) const { return (x * other.x) + (y * other.y); }
+
 	/**
 	 * Calculate the cross product of two vetors.
-	 * 
+	 *
 	 * @param other The other vector to perform the cross operation with.
 	 *
-	 * @return Vector result of the cross operation.
+	 * @return Scalar result of the cross operation (the z component of the 3D cross product).
 	 */
-	double cross(const Vector2& other) const;
+	constexpr T cross(const BasicVector2& other) const { return (x * other.y) - (y * other.x); }
 
 	/**
 	 * @brief Calculates the distance between two vectors.
 	 *
 	 * @param other The other vector to perform the distance calculation with.
 	 *
-	 * @return Vector result of the dot operation.
+	 * @return The distance between both vectors.
 	 */
-	double distance(const Vector2& other) const;
+	T distance(const BasicVector2& other) const { return (*this - other).get_magnitude(); }
 
-	double project(const Vector2& other) const;
+	/**
+	 * @brief Calculates the squared distance between two vectors, without taking a square root.
+	 *
+	 * @param other The other vector to perform the distance calculation with.
+	 *
+	 * @return The squared distance between both vectors.
+	 */
+	constexpr T distance_squared(const BasicVector2& other) const { return (*this - other).get_magnitude_squared(); }
+
+	/**
+	 * Calculates the length of this vector's projection onto another vector.
+	 * @param other The vector to project onto.
+	 */
+	T project(const BasicVector2& other) const { return dot(other) / other.get_magnitude(); }
 
 	// Operators
 
 	/**
 	 * Scalar and vector addition
 	 */
-	friend Vector2 operator+(const Vector2& first, const Vector2& second);
-	friend Vector2 operator+(const Vector2& first, double scalar);
-	friend Vector2 operator+(double scalar, const Vector2& second);
-	
-	Vector2& operator+=(const Vector2& other);
-	Vector2& operator+=(const double scalar);
+	friend constexpr BasicVector2 operator+(const BasicVector2& first, const BasicVector2& second) {
+		return BasicVector2(first.x + second.x, first.y + second.y);
+	}
+	friend constexpr BasicVector2 operator+(const BasicVector2& first, T scalar) {
+		return BasicVector2(first.x + scalar, first.y + scalar);
+	}
+	friend constexpr BasicVector2 operator+(T scalar, const BasicVector2& second) {
+		return BasicVector2(scalar + second.x, scalar + second.y);
+	}
+
+	BasicVector2& operator+=(const BasicVector2& other) {
+		x += other.x;
+		y += other.y;
+		return *this;
+	}
+	BasicVector2& operator+=(const T scalar) {
+		x += scalar;
+		y += scalar;
+		return *this;
+	}
 
 	/**
 	 * Scalar and vector subtraction
 	 */
-	friend Vector2 operator-(const Vector2& first, const Vector2& second);
-	friend Vector2 operator-(const Vector2& first, double scalar);
-	friend Vector2 operator-(double scalar, const Vector2& second);
+	friend constexpr BasicVector2 operator-(const BasicVector2& first, const BasicVector2& second) {
+		return BasicVector2(first.x - second.x, first.y - second.y);
+	}
+	friend constexpr BasicVector2 operator-(const BasicVector2& first, T scalar) {
+		return BasicVector2(first.x - scalar, first.y - scalar);
+	}
+	friend constexpr BasicVector2 operator-(T scalar, const BasicVector2& second) {
+		return BasicVector2(scalar - second.x, scalar - second.y);
+	}
 
-	Vector2& operator-=(const Vector2& other);
-	Vector2& operator-=(const double scalar);
+	BasicVector2& operator-=(const BasicVector2& other) {
+		x -= other.x;
+		y -= other.y;
+		return *this;
+	}
+	BasicVector2& operator-=(const T scalar) {
+		x -= scalar;
+		y -= scalar;
+		return *this;
+	}
 
 	/**
 	 * Scalar and vector multiplication
 	 */
-	friend Vector2 operator*(const Vector2& first, const Vector2& second);
-	friend Vector2 operator*(const Vector2& first, double scalar);
-	friend Vector2 operator*(const double scalar, const Vector2& second);
+	friend constexpr BasicVector2 operator*(const BasicVector2& first, const BasicVector2& second) {
+		return BasicVector2(first.x * second.x, first.y * second.y);
+	}
+	friend constexpr BasicVector2 operator*(const BasicVector2& first, T scalar) {
+		return BasicVector2(first.x * scalar, first.y * scalar);
+	}
+	friend constexpr BasicVector2 operator*(T scalar, const BasicVector2& second) {
+		return BasicVector2(scalar * second.x, scalar * second.y);
+	}
 
-	Vector2& operator*=(const Vector2& other);
-	Vector2& operator*=(const double scalar);
+	BasicVector2& operator*=(const BasicVector2& other) {
+		x *= other.x;
+		y *= other.y;
+		return *this;
+	}
+	BasicVector2& operator*=(const T scalar) {
+		x *= scalar;
+		y *= scalar;
+		return *this;
+	}
 
 	/**
 	 * Scalar and vector division
 	 */
-	friend Vector2 operator/(const Vector2& first, const Vector2& second);
-	friend Vector2 operator/(const Vector2& first, double scalar);
-	friend Vector2 operator/(double scalar, const Vector2& second);
+	friend constexpr BasicVector2 operator/(const BasicVector2& first, const BasicVector2& second) {
+		return BasicVector2(first.x / second.x, first.y / second.y);
+	}
+	friend constexpr BasicVector2 operator/(const BasicVector2& first, T scalar) {
+		return BasicVector2(first.x / scalar, first.y / scalar);
+	}
+	friend constexpr BasicVector2 operator/(T scalar, const BasicVector2& second) {
+		return BasicVector2(scalar / second.x, scalar / second.y);
+	}
+
+	BasicVector2& operator/=(const BasicVector2& other) {
+		if (other.x != 0 && other.y != 0) {
+			x /= other.x;
+			y /= other.y;
+		}
 
-	Vector2& operator/=(const Vector2& other);
-	Vector2& operator/=(const double scalar);
+		return *this;
+	}
+	BasicVector2& operator/=(const T scalar) {
+		x /= scalar;
+		y /= scalar;
+		return *this;
+	}
 
 	/**
 	 * Vector comparison
 	 */
-	friend bool operator==(const Vector2& first, const Vector2& second);
+	friend constexpr bool operator==(const BasicVector2& first, const BasicVector2& second) {
+		return (first.x == second.x) && (first.y == second.y);
+	}
 
 private:
 	/**
 	 * The x value of the vector
 	*/
-	double x;
+	T x;
 
 	/**
 	 * The y value of the vector
 	*/
-	double y;
+	T y;
 };
 
-} // namaespace tao
\ No newline at end of file
+/** A vector with single precision components, for math that doesn't need double precision. */
+typedef BasicVector2<float> Vector2f;
+
+/** A vector with double precision components. */
+typedef BasicVector2<double> Vector2d;
+
+/** The vector used throughout the library, with double precision components. */
+typedef BasicVector2<double> Vector2;
+
+} // namespace tao
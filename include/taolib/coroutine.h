@@ -0,0 +1,342 @@
+/**
+ * @file src/taolib/coroutine.h
+ * @author Tropical
+ *
+ * Coroutine-based autonomous routines.
+ *
+ * Routines are written as straight-line code that awaits movements, delays and other routines,
+ * and are run by an Executor on a single thread. Running routines side by side (with when_all
+ * and when_any) lets intakes, lifts and other mechanisms work while the drivetrain is moving,
+ * without a thread for each of them:
+ *
+ *     tao::coroutine::Task intake_until_loaded() {
+ *         intake.spin(vex::forward);
+ *         co_await tao::coroutine::wait_until([] { return loaded(); });
+ *         intake.stop();
+ *     }
+ *
+ *     tao::coroutine::Task autonomous_routine() {
+ *         co_await tao::coroutine::when_all(
+ *             tao::coroutine::drive(drivetrain, 24),
+ *             intake_until_loaded()
+ *         );
+ *         co_await tao::coroutine::turn_to(drivetrain, 90);
+ *     }
+ *
+ *     tao::coroutine::Executor().run(autonomous_routine());
+ *
+ * Coroutines require C++20, which isn't supported by VEXcode's compiler. TAO_COROUTINES is defined
+ * as 1 if they are available and 0 otherwise. Without coroutines, the same overlap can be achieved with
+ * non-blocking movements and DifferentialDrivetrain::wait_until_settled(timeout).
+ */
+
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define TAO_COROUTINES 1
+#endif
+#endif
+
+#ifndef TAO_COROUTINES
+#define TAO_COROUTINES 0
+#endif
+
+#if TAO_COROUTINES
+
+#include <coroutine>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "env.h"
+#include "Vector2.h"
+#include "DifferentialDrivetrain.h"
+
+namespace tao {
+namespace coroutine {
+
+class Executor;
+
+#ifndef DOXYGEN_IGNORE
+namespace internal {
+
+// Cancels every routine started under it (and under any of its children) when a when_any finishes.
+struct CancelToken {
+	std::shared_ptr<CancelToken> parent;
+	bool cancelled = false;
+
+	bool is_cancelled() const { return cancelled || (parent != nullptr && parent->is_cancelled()); }
+};
+
+} // namespace internal
+#endif /* DOXYGEN_IGNORE */
+
+/**
+ * A routine that can be awaited by other routines, or run by an Executor.
+ * Routines don't start until they are awaited or run, and a routine is destroyed along with its Task.
+ */
+class Task {
+public:
+	struct promise_type {
+		// The routine awaiting this one, which is resumed once this one finishes.
+		std::coroutine_handle<> continuation;
+
+		// Inherited from the routine that started this one.
+		Executor* executor = nullptr;
+		std::shared_ptr<internal::CancelToken> token;
+
+		Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+
+		struct FinalAwaiter {
+			bool await_ready() noexcept { return false; }
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+				std::coroutine_handle<> continuation = handle.promise().continuation;
+				return continuation ? continuation : std::noop_coroutine();
+			}
+			void await_resume() noexcept {}
+		};
+		FinalAwaiter final_suspend() noexcept { return {}; }
+
+		void return_void() {}
+		void unhandled_exception() { std::abort(); }
+	};
+
+	Task() = default;
+	Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+	Task& operator=(Task&& other) noexcept {
+		if (this != &other) {
+			if (handle) handle.destroy();
+			handle = std::exchange(other.handle, nullptr);
+		}
+		return *this;
+	}
+	~Task() { if (handle) handle.destroy(); }
+
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+
+	/** @return True if the routine has run to completion. */
+	bool done() const { return !handle || handle.done(); }
+
+	// Awaiting a task runs it as part of the awaiting routine, which continues once it finishes.
+	bool await_ready() const { return done(); }
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> parent) {
+		handle.promise().continuation = parent;
+		handle.promise().executor = parent.promise().executor;
+		handle.promise().token = parent.promise().token;
+		return handle;
+	}
+	void await_resume() {}
+
+private:
+	explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+	std::coroutine_handle<promise_type> handle;
+
+	friend class Executor;
+	friend class WhenAll;
+	friend class WhenAny;
+};
+
+/**
+ * Runs routines on the thread that calls run() or poll().
+ *
+ * Routines waiting on a condition (such as a movement settling or a delay passing) are checked
+ * every time the executor is polled, and resumed once their condition is met.
+ *
+ * @attention An executor isn't thread-safe. Routines should only be run or spawned from the thread that polls it.
+ */
+class Executor {
+public:
+	/**
+	 * Creates an executor.
+	 * @param period The time in milliseconds between each poll when the executor is run with run().
+	 */
+	Executor(uint32_t period = 5);
+	~Executor();
+
+	Executor(const Executor&) = delete;
+	Executor& operator=(const Executor&) = delete;
+
+	/**
+	 * Runs a routine until it finishes, polling every period. This blocks the calling thread.
+	 * Routines started with spawn() also run in the meantime.
+	 * @param task The routine to run.
+	 */
+	void run(Task task);
+
+	/**
+	 * Starts a routine in the background. It runs whenever the executor is polled, until it finishes.
+	 * @param task The routine to start.
+	 */
+	void spawn(Task task);
+
+	/**
+	 * Resumes every routine that is ready to continue. This can be called from a periodic task (see
+	 * threading::TaskScheduler) to run routines without blocking a thread.
+	 */
+	void poll();
+
+	/** @return True if no routines are running or waiting. */
+	bool is_idle() const;
+
+#ifndef DOXYGEN_IGNORE
+	// Resumes a routine once a condition is met, unless it is cancelled first.
+	void wait(std::function<bool()> ready, std::coroutine_handle<> handle, std::shared_ptr<internal::CancelToken> token);
+
+	// Runs a routine until it first waits, as part of the routine that started it.
+	static void start(Task& task, Executor* executor, std::shared_ptr<internal::CancelToken> token);
+#endif /* DOXYGEN_IGNORE */
+
+private:
+	struct Waiter {
+		std::function<bool()> ready;
+		std::coroutine_handle<> handle;
+		std::shared_ptr<internal::CancelToken> token;
+	};
+
+	uint32_t period;
+	std::vector<Waiter> waiters;
+	std::vector<Task> spawned;
+};
+
+/**
+ * Waits until a condition is true. The condition is checked every time the executor is polled.
+ */
+class Condition {
+public:
+	Condition(std::function<bool()> ready) : ready(std::move(ready)) {}
+
+	bool await_ready() const { return ready(); }
+	void await_suspend(std::coroutine_handle<Task::promise_type> handle) {
+		handle.promise().executor->wait(ready, handle, handle.promise().token);
+	}
+	void await_resume() {}
+
+private:
+	std::function<bool()> ready;
+};
+
+/**
+ * Waits until a condition is true.
+ * @param ready The condition to wait for.
+ */
+Condition wait_until(std::function<bool()> ready);
+
+/**
+ * Waits for an amount of time.
+ * @param duration The time to wait in milliseconds.
+ */
+Condition delay(uint32_t duration);
+
+/**
+ * Starts a movement when awaited, then waits until it ends.
+ * The movement's final status is the result of the await.
+ */
+class Movement {
+public:
+	Movement(DifferentialDrivetrain& drivetrain, std::function<void()> start) : drivetrain(drivetrain), start(std::move(start)) {}
+
+	bool await_ready() const { return false; }
+	void await_suspend(std::coroutine_handle<Task::promise_type> handle);
+	DifferentialDrivetrain::MoveStatus await_resume() { return drivetrain.get_move_status(); }
+
+private:
+	DifferentialDrivetrain& drivetrain;
+	std::function<void()> start;
+	uint32_t id = 0;
+};
+
+/**
+ * Awaitable versions of the drivetrain's movement functions. Each one ends once its movement settles, is aborted,
+ * or is replaced by another movement (such as when a drive and turn_to are awaited together in when_all).
+ * @note A movement keeps going if the routine awaiting it is cancelled by when_any.
+ */
+Movement drive(DifferentialDrivetrain& drivetrain, double distance);
+Movement turn_to(DifferentialDrivetrain& drivetrain, double heading);
+Movement turn_to(DifferentialDrivetrain& drivetrain, Vector2 point);
+Movement move_to(DifferentialDrivetrain& drivetrain, Vector2 point);
+Movement follow_path(DifferentialDrivetrain& drivetrain, std::vector<Vector2> path);
+
+/** Runs several routines side by side, waiting until all of them finish. */
+class WhenAll {
+public:
+	WhenAll(std::vector<Task> tasks) : tasks(std::move(tasks)) {}
+
+	bool await_ready() const;
+	bool await_suspend(std::coroutine_handle<Task::promise_type> handle);
+	void await_resume() {}
+
+private:
+	std::vector<Task> tasks;
+};
+
+/**
+ * Runs several routines side by side, waiting until one of them finishes. The rest are cancelled, which destroys them
+ * at whatever point they were waiting.
+ */
+class WhenAny {
+public:
+	WhenAny(std::vector<Task> tasks) : tasks(std::move(tasks)) {}
+
+	bool await_ready() const;
+	bool await_suspend(std::coroutine_handle<Task::promise_type> handle);
+
+	/** @return The index of the routine that finished first. */
+	std::size_t await_resume();
+
+private:
+	std::vector<Task> tasks;
+	std::shared_ptr<internal::CancelToken> token;
+};
+
+#ifndef DOXYGEN_IGNORE
+namespace internal {
+
+// Routines can be passed directly, or awaitables (like movements and delays) can be passed and wrapped into a routine.
+inline Task to_task(Task task) { return task; }
+
+template <typename Awaitable>
+Task to_task(Awaitable awaitable) {
+	co_await awaitable;
+}
+
+} // namespace internal
+#endif /* DOXYGEN_IGNORE */
+
+/**
+ * Runs several routines or awaitables side by side, waiting until all of them finish.
+ * @param awaitables The routines, movements or delays to run.
+ */
+template <typename... Awaitables>
+WhenAll when_all(Awaitables... awaitables) {
+	std::vector<Task> tasks;
+	Task converted[] = { internal::to_task(std::move(awaitables))... };
+	for (Task& task : converted) tasks.push_back(std::move(task));
+	return WhenAll(std::move(tasks));
+}
+
+/**
+ * Runs several routines or awaitables side by side, waiting until one of them finishes and cancelling the rest.
+ * This can be used to give a routine a timeout, such as `co_await when_any(move_to(drivetrain, point), delay(2000))`.
+ * @param awaitables The routines, movements or delays to run.
+ * @return An awaitable that results in the index of the first routine to finish.
+ */
+template <typename... Awaitables>
+WhenAny when_any(Awaitables... awaitables) {
+	std::vector<Task> tasks;
+	Task converted[] = { internal::to_task(std::move(awaitables))... };
+	for (Task& task : converted) tasks.push_back(std::move(task));
+	return WhenAny(std::move(tasks));
+}
+
+} // namespace coroutine
+} // namespace tao
+
+#endif /* TAO_COROUTINES */
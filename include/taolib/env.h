@@ -8,20 +8,31 @@
 #pragma once
 
 // Determines the current enviornment
+// Defaults to VEXcode. Define TAO_ENV_PROS when compiling for PROS, or TAO_ENV_HOST when compiling
+// tools and tests that run on a computer.
+#if !defined(TAO_ENV_VEXCODE) && !defined(TAO_ENV_PROS) && !defined(TAO_ENV_HOST)
 #define TAO_ENV_VEXCODE
-// #define TAO_ENV_PROS
+#endif
 
 // Include the required environment libraries
 #ifdef TAO_ENV_VEXCODE
 #include "v5_cpp.h"
 #elif defined(TAO_ENV_PROS)
 #include "api.h"
+#elif defined(TAO_ENV_HOST)
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #endif
 
+#include <atomic>
 #include <memory>
 #include <cstdint>
+#include <cstddef>
 #include <functional>
 
+#include "Vector2.h"
+
 namespace tao {
 namespace env {
 
@@ -35,6 +46,10 @@ namespace env {
 
 	constexpr auto sleep_for = static_cast<void(*)(uint32_t)>(vex::this_thread::sleep_for);
 	constexpr auto high_resolution_clock = vex::timer::systemHighResolution;
+
+	constexpr int32_t THREAD_PRIORITY_LOW = 1;
+	constexpr int32_t THREAD_PRIORITY_NORMAL = 7;
+	constexpr int32_t THREAD_PRIORITY_HIGH = 15;
 #elif defined(TAO_ENV_PROS)
 	using Thread = pros::Task;
 	using Mutex = pros::Mutex;
@@ -44,21 +59,94 @@ namespace env {
 
 	constexpr auto sleep_for = pros::delay;
 	constexpr auto high_resolution_clock = pros::micros;
+
+	constexpr int32_t THREAD_PRIORITY_LOW = TASK_PRIORITY_MIN + 1;
+	constexpr int32_t THREAD_PRIORITY_NORMAL = TASK_PRIORITY_DEFAULT;
+	constexpr int32_t THREAD_PRIORITY_HIGH = TASK_PRIORITY_MAX - 2;
+#elif defined(TAO_ENV_HOST)
+	// Simulated devices for running on a computer. Each reading is a plain field that can be set directly,
+	// and the last commanded voltage is stored rather than applied to anything.
+	namespace host {
+		struct MotorGroup {
+			double rotation = 0.0, velocity = 0.0, current = 0.0, temperature = 0.0;
+			double voltage = 0.0;
+		};
+
+		struct IMU {
+			bool installed = true, calibrating = false;
+			double heading = 0.0, rotation = 0.0;
+			double acceleration_x = 0.0, acceleration_y = 0.0;
+		};
+
+		struct Encoder {
+			int32_t rotation = 0;
+			double velocity = 0.0;
+		};
+	} // namespace host
+
+	using Thread = std::thread;
+	using Mutex = std::mutex;
+	using MotorGroup = host::MotorGroup;
+	using IMU = host::IMU;
+	using Encoder = host::Encoder;
+
+	void sleep_for(uint32_t duration);
+	uint64_t high_resolution_clock();
+
+	// Threads on the host are scheduled by the operating system, so priorities are ignored.
+	constexpr int32_t THREAD_PRIORITY_LOW = 0;
+	constexpr int32_t THREAD_PRIORITY_NORMAL = 0;
+	constexpr int32_t THREAD_PRIORITY_HIGH = 0;
 #endif
 
 bool imu_is_installed(IMU& imu);
 bool imu_is_calibrating(IMU& imu);
 double imu_get_heading(IMU& imu);
+double imu_get_rotation(IMU& imu);
+Vector2 imu_get_acceleration(IMU& imu);
 void imu_calibrate(IMU& imu);
 void imu_reset_heading(IMU& imu);
 
 double motor_group_get_rotation(MotorGroup& encoder);
+double motor_group_get_velocity(MotorGroup& group);
+double motor_group_get_current(MotorGroup& group);
+double motor_group_get_temperature(MotorGroup& group);
 void motor_group_set_voltage(MotorGroup& group, double voltage);
 void motor_group_reset_rotation(MotorGroup& motor_group);
 
 int32_t encoder_get_rotation(Encoder& encoder);
+double encoder_get_velocity(Encoder& encoder);
 void encoder_reset_rotation(Encoder& encoder);
 
+void thread_set_priority(Thread& thread, int32_t priority);
+
+/**
+ * Gets a number identifying the thread that calls this function.
+ * @return The id of the current thread, which is unique among running threads.
+ */
+uint32_t thread_current_id();
+
+/**
+ * Gives up the rest of the current thread's time slice to other threads of the same priority.
+ */
+void thread_yield();
+
+/**
+ * Reads a byte of serial input (sent from a computer over the USB connection) without blocking.
+ * @return The byte that was read, or -1 if no input is waiting.
+ */
+int32_t serial_read();
+
+/**
+ * Writes data to a file on the brain's SD card.
+ * @param path The path of the file, relative to the root of the SD card (or the working directory on a computer).
+ * @param data The bytes to write.
+ * @param size The number of bytes to write.
+ * @param append Determines if data is added to the end of the file, rather than replacing its contents.
+ * @return True if all of the data was written, false otherwise (such as if no SD card is inserted).
+ */
+bool file_write(const char* path, const char* data, std::size_t size, bool append = false);
+
 class Timer {
 public:
 	Timer();
@@ -70,5 +158,76 @@ private:
 	int64_t timestamp;
 };
 
+/**
+ * A one-time signal that blocks a thread until another thread releases it, such as when waiting for a new thread to
+ * finish setting itself up. The waiting thread sleeps in the scheduler rather than polling, where the platform allows.
+ * @attention On PROS, wait() must be called from the thread that created the latch.
+ */
+class Latch {
+public:
+	Latch();
+
+	Latch(const Latch&) = delete;
+	Latch& operator=(const Latch&) = delete;
+
+	/** Releases the waiting thread. The latch may be destroyed by the waiting thread as soon as this is called. */
+	void release();
+
+	/** Blocks the current thread until release() is called, returning immediately if it already has been. */
+	void wait();
+
+private:
+	std::atomic<bool> released;
+
+#ifdef TAO_ENV_PROS
+	// Woken with a task notification, which is the lightest blocking primitive FreeRTOS has.
+	pros::task_t waiter;
+#elif defined(TAO_ENV_HOST)
+	std::mutex mutex;
+	std::condition_variable condition;
+#endif
+};
+
+/**
+ * Lets any number of threads sleep until another thread notifies them, without missing a notification that happens
+ * between checking a condition and starting to wait. Used to build events and other blocking primitives:
+ *
+ *     uint32_t token = notifier.prepare_wait();
+ *     if (!condition) notifier.wait(token);
+ *
+ * Waiters can wake without being notified, so they should check their condition again after waking.
+ */
+class Notifier {
+public:
+	Notifier();
+
+	Notifier(const Notifier&) = delete;
+	Notifier& operator=(const Notifier&) = delete;
+
+	/**
+	 * Starts waiting. This should be called before checking the condition being waited on.
+	 * @return A token to pass to wait().
+	 */
+	uint32_t prepare_wait() const;
+
+	/**
+	 * Blocks the current thread until notify_all() is called after the token was taken, or until a timeout passes.
+	 * @param token The token returned by prepare_wait().
+	 * @param timeout The maximum time to wait in milliseconds. A timeout of 0 waits indefinitely.
+	 */
+	void wait(uint32_t token, uint32_t timeout = 0);
+
+	/** Wakes every waiting thread. */
+	void notify_all();
+
+private:
+	std::atomic<uint32_t> generation;
+
+#ifdef TAO_ENV_HOST
+	std::mutex mutex;
+	std::condition_variable condition;
+#endif
+};
+
 } // namespace env
 } // namespace tao
\ No newline at end of file
@@ -0,0 +1,105 @@
+/**
+ * @file src/taolib/geometry.h
+ * @author Tropical
+ *
+ * Intersection, distance and containment tests for segments, circles, polylines and polygons.
+ *
+ * Results along a segment are given as a parameter t, where t = 0 is the start of the segment, t = 1 is its end, and
+ * the point itself is start + (end - start) * t. Comparing t values is cheaper than comparing distances, and says which
+ * result comes first along a path. Every function returns its results by value in fixed-size structures, so none of
+ * them allocate, and they can be used freely inside the tracking loop.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Vector2.h"
+
+namespace tao {
+namespace geometry {
+
+/**
+ * Up to N points where a segment meets another shape, ordered by how far along the segment they are.
+ */
+template <std::size_t N>
+struct Intersections {
+	/** The number of intersections found (from 0 to N). Only the first `count` entries of `t` and `points` are set. */
+	std::size_t count;
+
+	/** How far along the segment each intersection is, from 0 to 1, in increasing order. */
+	double t[N];
+
+	/** The location of each intersection. */
+	Vector2 points[N];
+};
+
+/**
+ * Finds where a line segment crosses a circle.
+ *
+ * @param start The starting point of the line segment.
+ * @param end The endpoint of the line segment.
+ * @param center The location of the circle's center point.
+ * @param radius The radius of the circle.
+ *
+ * @return Up to two intersections. A segment that only touches the circle has one, and a segment of zero length has
+ * none.
+ */
+Intersections<2> segment_circle_intersections(Vector2 start, Vector2 end, Vector2 center, double radius);
+
+/**
+ * Finds where two line segments cross.
+ *
+ * @param start_1 The starting point of the first segment.
+ * @param end_1 The endpoint of the first segment.
+ * @param start_2 The starting point of the second segment.
+ * @param end_2 The endpoint of the second segment.
+ *
+ * @return The intersection, with t measured along the first segment. Parallel (and overlapping) segments have none.
+ */
+Intersections<1> segment_intersection(Vector2 start_1, Vector2 end_1, Vector2 start_2, Vector2 end_2);
+
+/**
+ * Finds the point on a line segment closest to another point.
+ *
+ * @param start The starting point of the line segment.
+ * @param end The endpoint of the line segment.
+ * @param point The point to measure from.
+ * @param t If not null, receives how far along the segment (from 0 to 1) the closest point is.
+ *
+ * @return The closest point on the segment.
+ */
+Vector2 closest_point_on_segment(Vector2 start, Vector2 end, Vector2 point, double* t = nullptr);
+
+/**
+ * Finds the distance from a point to the closest part of a polyline (a path of connected segments).
+ *
+ * @param points The points of the polyline, where segment i runs from point i to point i + 1.
+ * @param count The number of points.
+ * @param point The point to measure from.
+ * @param segment If not null, receives the index of the closest segment.
+ * @param t If not null, receives how far along the closest segment (from 0 to 1) the closest point is.
+ *
+ * @return The distance to the polyline. A single point is treated as a polyline of zero length, and an empty one
+ * is infinitely far away.
+ */
+double distance_to_polyline(const Vector2* points, std::size_t count, Vector2 point, std::size_t* segment = nullptr, double* t = nullptr);
+double distance_to_polyline(const std::vector<Vector2>& points, Vector2 point, std::size_t* segment = nullptr, double* t = nullptr);
+
+/**
+ * Determines whether a point is inside a polygon, such as a zone of the field.
+ * Polygons can be concave, and self-intersecting polygons use the even-odd rule. Points exactly on an edge may be
+ * counted as inside or outside.
+ *
+ * @param vertices The vertices of the polygon in order, without repeating the first one at the end.
+ * @param count The number of vertices.
+ * @param point The point to test.
+ *
+ * @return True if the point is inside the polygon.
+ */
+bool polygon_contains(const Vector2* vertices, std::size_t count, Vector2 point);
+bool polygon_contains(const std::vector<Vector2>& vertices, Vector2 point);
+
+} // namespace geometry
+} // namespace tao
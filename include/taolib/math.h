@@ -93,6 +93,7 @@ constexpr T sign(T value) {
  * @param point_2 The endpoint of the line segment.
  * 
  * @return 0-2 Vector2 instances representing an intersection between the line segment and the circle.
+ * @deprecated Allocates a vector for its results. Use geometry::segment_circle_intersections instead.
  */
 std::vector<Vector2> line_circle_intersections(Vector2 center, double radius, Vector2 point_1, Vector2 point_2);
 
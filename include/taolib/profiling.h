@@ -0,0 +1,149 @@
+/**
+ * @file src/taolib/profiling.h
+ * @author Tropical
+ *
+ * Lightweight timing instrumentation for hot code paths.
+ *
+ * Durations are measured with scoped timers and recorded into fixed-bucket histograms, which
+ * track the count, minimum, maximum, mean and approximate percentiles of every sample along with
+ * the number of samples that went over a time budget. Recording a sample is a handful of integer
+ * operations and never allocates, so instrumentation can be left in competition builds.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "env.h"
+
+/**
+ * Determines if profiling is compiled into the program (enabled by default).
+ * Defining `TAO_PROFILING=0` removes every TAO_PROFILE_* macro entirely, including the clock reads.
+ */
+#ifndef TAO_PROFILING
+#define TAO_PROFILING 1
+#endif
+
+#ifndef DOXYGEN_IGNORE
+#define TAO_PROFILE_CONCAT_INNER_(a, b) a##b
+#define TAO_PROFILE_CONCAT_(a, b) TAO_PROFILE_CONCAT_INNER_(a, b)
+#endif /* DOXYGEN_IGNORE */
+
+#if TAO_PROFILING
+/** Records the time until the end of the enclosing scope into a histogram. */
+#define TAO_PROFILE_SCOPE(histogram) \
+	::tao::profiling::ScopedTimer TAO_PROFILE_CONCAT_(tao_profile_scope_, __LINE__)(histogram)
+
+/** Records a duration in microseconds into a histogram. */
+#define TAO_PROFILE_RECORD(histogram, duration) (histogram).record(duration)
+#else
+#define TAO_PROFILE_SCOPE(histogram) do {} while (0)
+#define TAO_PROFILE_RECORD(histogram, duration) do {} while (0)
+#endif
+
+namespace tao {
+namespace profiling {
+
+/**
+ * A histogram of durations in microseconds.
+ *
+ * Buckets are spaced logarithmically, with four buckets for every power of two, so percentiles are accurate
+ * to within 25% at any scale from a single microsecond up to over an hour. Minimum and maximum are exact.
+ */
+class Histogram {
+public:
+	/** A summary of every sample recorded by a histogram. All durations are in microseconds. */
+	struct Stats {
+		/** Number of samples recorded. */
+		uint32_t count;
+
+		/** Shortest and longest samples. */
+		uint32_t min, max;
+
+		/** Average of every sample. */
+		double mean;
+
+		/** Median, 90th and 99th percentile samples (upper bounds of the buckets they fall into). */
+		uint32_t p50, p90, p99;
+
+		/** Number of samples that were longer than the histogram's budget. */
+		uint32_t overruns;
+	};
+
+	/** Number of buckets, which covers every 32-bit duration. */
+	static constexpr std::size_t BUCKET_COUNT = 124;
+
+	/**
+	 * Creates an empty histogram.
+	 * @param budget Samples longer than this many microseconds are counted as overruns. A budget of zero disables overrun counting.
+	 */
+	Histogram(uint32_t budget = 0);
+
+	/**
+	 * Records a sample.
+	 * @param duration The duration in microseconds.
+	 */
+	void record(uint32_t duration);
+
+	/** Removes every sample, keeping the budget. */
+	void reset();
+
+	/**
+	 * Calculates an approximate percentile of every sample.
+	 * @param percentile The percentile from 0 to 100.
+	 * @return The upper bound of the bucket holding the percentile, clamped to the longest sample.
+	 */
+	uint32_t get_percentile(double percentile) const;
+
+	/**
+	 * Summarizes every sample.
+	 * @return The histogram's stats, or all zeros if no samples have been recorded.
+	 */
+	Stats get_stats() const;
+
+	uint32_t get_budget() const;
+	void set_budget(uint32_t budget);
+
+	/**
+	 * Gets the bucket that a duration is recorded into.
+	 * @param duration The duration in microseconds.
+	 * @return The index of the bucket.
+	 */
+	static std::size_t bucket_index(uint32_t duration);
+
+	/**
+	 * Gets the longest duration recorded into a bucket.
+	 * @param index The index of the bucket.
+	 * @return The bucket's inclusive upper bound in microseconds.
+	 */
+	static uint32_t bucket_upper_bound(std::size_t index);
+
+private:
+	uint32_t buckets[BUCKET_COUNT];
+	uint32_t count;
+	uint32_t min, max;
+	uint64_t total;
+	uint32_t overruns;
+	uint32_t budget;
+};
+
+/**
+ * Measures the time from its construction to its destruction, recording it into a histogram.
+ * Usually created through TAO_PROFILE_SCOPE, so that it can be compiled out.
+ */
+class ScopedTimer {
+public:
+	ScopedTimer(Histogram& histogram);
+	~ScopedTimer();
+
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+	Histogram& histogram;
+	uint64_t start;
+};
+
+} // namespace profiling
+} // namespace tao
@@ -1,8 +1,20 @@
 #include "DifferentialDrivetrain.h"
 #include "math.h"
+#include "geometry.h"
+#include "trig.h"
 #include "threading.h"
+#include "coroutine.h"
 #include "PIDController.h"
+#include "Feedforward.h"
+#include "RateScheduler.h"
+#include "telemetry.h"
+#include "SensorFrame.h"
+#include "FlightRecorder.h"
+#include "TuningConsole.h"
+#include "profiling.h"
+#include "trace.h"
 #include "Vector2.h"
+#include "PointBuffer.h"
 #include "env.h"
 
 namespace tao {}
\ No newline at end of file
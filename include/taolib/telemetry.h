@@ -0,0 +1,256 @@
+/**
+ * @file src/taolib/telemetry.h
+ * @author Tropical
+ *
+ * Compact binary telemetry frames for streaming drivetrain state over a slow serial link.
+ *
+ * Each frame carries one Sample. Values are quantized to fixed point, then written as zigzag
+ * varints, either as absolute values (keyframes) or as the difference from the previous frame
+ * (delta frames). A CRC-16 is appended, and the frame is COBS-encoded and surrounded by zero
+ * bytes so that it can share a stream with plain text logs. A typical delta frame is 20-30 bytes.
+ *
+ * Telemetry is delivered to subscribed sinks by a Publisher over several channels, each with
+ * its own rate, so that cheap high-rate data (pose) and rarely changing data (gains) can be
+ * streamed together without wasting bandwidth.
+ *
+ * This file has no platform dependencies, so it can also be compiled into host-side tools
+ * (see tools/telemetry_decoder.cpp).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "PIDController.h"
+
+namespace tao {
+namespace telemetry {
+
+/** Version of the frame layout, incremented whenever fields are added or changed. */
+constexpr uint8_t SCHEMA_VERSION = 1;
+
+/** The largest possible encoded frame size in bytes, including delimiters. */
+constexpr std::size_t MAX_FRAME_SIZE = 96;
+
+/**
+ * A single snapshot of drivetrain state.
+ */
+struct Sample {
+	/** Time in microseconds since the tracking period started. */
+	uint32_t timestamp;
+
+	/** Global position of the drivetrain (quantized to 0.001 distance units). */
+	double x, y;
+
+	/** Heading of the drivetrain in degrees (quantized to 0.01 degrees). */
+	double heading;
+
+	/** Drive error (quantized to 0.001 distance units) and turn error (quantized to 0.01 degrees). */
+	double drive_error, turn_error;
+
+	/** Proportional, integral and derivative terms of the drive PID controller (quantized to 0.01%). */
+	double drive_p, drive_i, drive_d;
+
+	/** Proportional, integral and derivative terms of the turn PID controller (quantized to 0.01%). */
+	double turn_p, turn_i, turn_d;
+
+	/** Voltage applied to each side of the drivetrain (quantized to 1mV). */
+	double left_voltage, right_voltage;
+};
+
+/**
+ * The position and heading of the drivetrain.
+ */
+struct Pose {
+	/** Time in microseconds since the tracking period started. */
+	uint32_t timestamp;
+
+	/** Global position of the drivetrain. */
+	double x, y;
+
+	/** Heading of the drivetrain in degrees. */
+	double heading;
+};
+
+/**
+ * The gain constants of each of the drivetrain's controllers.
+ */
+struct Gains {
+	/** Time in microseconds since the tracking period started. */
+	uint32_t timestamp;
+
+	/** Gains of the drive, turn and velocity PID controllers. */
+	PIDController::Gains drive, turn, velocity;
+};
+
+/**
+ * Channels that telemetry is published on. Each channel has an independent rate.
+ */
+enum class Channel {
+	/** Pose of the drivetrain. Defaults to 50hz. */
+	Pose,
+
+	/** Full per-tick state of the drivetrain as a Sample (the same data that's sent as binary frames). Defaults to 100hz. */
+	State,
+
+	/** Controller gains. Defaults to 1hz. */
+	Gains
+};
+
+/**
+ * Receives telemetry from a Publisher.
+ * Override the functions for the channels that should be received. Every function does nothing by default.
+ *
+ * @attention Sinks are called from the drivetrain's tracking thread while its state is locked, so they must
+ * return quickly and must not call any functions on the drivetrain.
+ */
+class Sink {
+public:
+	virtual ~Sink() {}
+
+	virtual void on_pose(const Pose& pose) {}
+
+	virtual void on_state(const Sample& sample) {}
+
+	virtual void on_gains(const Gains& gains) {}
+};
+
+/**
+ * Publishes telemetry to subscribed sinks, decimating each channel to its own rate.
+ *
+ * The publisher is ticked by its owner at a fixed rate, and is then asked which channels are due,
+ * so that data for a channel is only gathered when it will actually be sent.
+ */
+class Publisher {
+public:
+	Publisher();
+
+	/**
+	 * Sets how often a channel is published.
+	 * @param channel The channel to change.
+	 * @param period The time between each publish in milliseconds. A period of 0 disables the channel.
+	 */
+	void set_period(Channel channel, uint32_t period);
+
+	/**
+	 * Gets how often a channel is published.
+	 * @param channel The channel to get the period of.
+	 * @return The time between each publish in milliseconds, or 0 if the channel is disabled.
+	 */
+	uint32_t get_period(Channel channel) const;
+
+	/**
+	 * Subscribes a sink to every channel.
+	 * @attention The sink is referenced rather than copied, so it must stay alive until it is unsubscribed.
+	 * @param sink The sink to subscribe.
+	 */
+	void subscribe(Sink& sink);
+
+	/**
+	 * Unsubscribes a sink from every channel.
+	 * @param sink The sink to unsubscribe.
+	 */
+	void unsubscribe(Sink& sink);
+
+	/**
+	 * Advances the publisher's clock, determining which channels are due.
+	 * @param elapsed The time since the last tick in milliseconds.
+	 */
+	void tick(uint32_t elapsed);
+
+	/**
+	 * Indicates if a channel should be published on the current tick.
+	 * @param channel The channel to check.
+	 * @return True if the channel's period has elapsed and it has subscribers, false otherwise.
+	 */
+	bool is_due(Channel channel) const;
+
+	/** Restarts the period of every channel, so that each one is due on the next tick. */
+	void reset();
+
+	void publish(const Pose& pose) const;
+
+	void publish(const Sample& sample) const;
+
+	void publish(const Gains& gains) const;
+
+private:
+	static constexpr std::size_t CHANNEL_COUNT = 3;
+
+	uint32_t periods[CHANNEL_COUNT];
+	uint32_t elapsed[CHANNEL_COUNT];
+	bool due[CHANNEL_COUNT];
+
+	std::vector<Sink*> sinks;
+};
+
+/**
+ * Encodes samples into frames.
+ * Delta frames depend on the previous frame, so an encoder should only be used for a single stream.
+ */
+class FrameEncoder {
+public:
+	/**
+	 * Creates a new encoder.
+	 * @param keyframe_interval A keyframe is sent every `keyframe_interval` frames, allowing a decoder to recover from lost frames.
+	 */
+	FrameEncoder(uint32_t keyframe_interval = 50);
+
+	/**
+	 * Encodes a sample into a frame.
+	 * @param sample The sample to encode.
+	 * @param buffer The buffer to write the frame to. Should be at least MAX_FRAME_SIZE bytes.
+	 * @param capacity The size of the buffer in bytes.
+	 * @return The size of the encoded frame in bytes, or 0 if the buffer is too small.
+	 */
+	std::size_t encode(const Sample& sample, uint8_t* buffer, std::size_t capacity);
+
+	/** Forces the next frame to be a keyframe. */
+	void reset();
+
+private:
+	uint32_t keyframe_interval;
+	uint32_t frame_count;
+	uint8_t sequence;
+	int32_t previous[14];
+};
+
+/**
+ * Decodes frames from a byte stream.
+ * Bytes that aren't part of a valid frame (such as text logs) are discarded.
+ */
+class FrameDecoder {
+public:
+	FrameDecoder();
+
+	/**
+	 * Feeds a single byte from the stream into the decoder.
+	 * @param byte The next byte of the stream.
+	 * @param sample Set to the decoded sample when a frame is completed.
+	 * @return True if a frame was completed and `sample` was written, false otherwise.
+	 */
+	bool push(uint8_t byte, Sample& sample);
+
+	/**
+	 * Gets the number of frames that were lost, either due to corruption or gaps in the sequence.
+	 * @return The number of lost frames.
+	 */
+	uint32_t get_lost_frames() const;
+
+private:
+	uint8_t buffer[MAX_FRAME_SIZE];
+	std::size_t size;
+	bool overflowed;
+
+	bool synchronized;
+	uint8_t sequence;
+	int32_t previous[14];
+	uint32_t lost_frames;
+
+	bool decode_frame(Sample& sample);
+};
+
+} // namespace telemetry
+} // namespace tao
@@ -12,9 +12,17 @@
 #pragma once
 
 #include <tuple>
+#include <type_traits>
 #include <utility>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
 
 #include "env.h"
+#include "profiling.h"
 
 namespace tao {
 namespace threading {
@@ -22,7 +30,7 @@ namespace threading {
 #ifndef DOXYGEN_IGNORE
 namespace internal {
 
-// Implementation of several missing standard library clstructs and functions to allow for `apply_`
+// Implementation of several missing standard library clstructs and functions to allow for `invoke_`
 template <std::size_t...>
 struct index_sequence_ {};
 
@@ -38,44 +46,58 @@ template <std::size_t N>
 using make_index_sequence_ = typename index_sequence_helper_<N>::type;
 
 template <typename Fn, typename Tuple, size_t... I>
-void apply_(Fn* fn, Tuple t, index_sequence_<I...>) {
-  (*fn)(std::get<I>(t)...);
+void invoke_(Fn& fn, Tuple& args, index_sequence_<I...>) {
+  fn(std::move(std::get<I>(args))...);
 }
 
+// The function and arguments of a thread that is being started. This lives on the stack of the thread calling
+// make_thread(), which waits until the new thread has moved everything onto its own stack.
 template <typename Fn, typename... Args>
-void wrap_func_(void* func_and_args_void) {
-  // Convert the void pointer to a pointer to the tuple of the function and arguments
-  auto* func_and_args = (std::tuple<Fn, std::tuple<Args...>, bool*>*)func_and_args_void;
-  // Mark the thread as initialized
-  *(std::get<2>(*func_and_args)) = true;
-  // Run the function with the arguments
-  apply_(std::get<0>(*func_and_args), std::get<1>(*func_and_args), make_index_sequence_<sizeof...(Args)>{});
-  delete func_and_args;
+struct Launch {
+  template <typename F, typename... A>
+  explicit Launch(F&& fn, A&&... args) : fn(std::forward<F>(fn)), args(std::forward<A>(args)...) {}
+
+  Fn fn;
+  std::tuple<Args...> args;
+  env::Latch started;
+};
+
+template <typename Fn, typename... Args>
+void launch_entry_(void* launch_void) {
+  auto* launch = static_cast<Launch<Fn, Args...>*>(launch_void);
+  Fn fn(std::move(launch->fn));
+  std::tuple<Args...> args(std::move(launch->args));
+  // The launch is gone once the starting thread is released, so nothing can touch it after this
+  launch->started.release();
+  invoke_(fn, args, make_index_sequence_<sizeof...(Args)>{});
 }
 
 } // namespace internal
 #endif /* DOXYGEN_IGNORE */
 
 /**
- * Creates a env::Thread that runs a given function with arguments
- * @param Ret return type of `fn`
- * @param Args types of arguments to `fn`
- * @param fn the target function
+ * Creates a env::Thread that runs a callable with arguments.
+ *
+ * The callable and arguments are moved (or copied, if they're lvalues) into the new thread without allocating, so
+ * lambdas and move-only types such as std::unique_ptr can be passed. This returns once the new thread has taken
+ * ownership of them.
+ * @tparam Fn type of `fn`
+ * @tparam Args types of arguments to `fn`
+ * @param fn the target function, lambda or function object
  * @param args the arguments to `fn`
  * @return env::Thread that is running `fn`
  */
-template <typename Ret, typename... Args>
-env::Thread make_thread(Ret (*fn)(Args...), Args... args) {
-  // Create a boolean value that gets set to true by the thread so that the thread gets initialized before this function exits; vex STL is buggy
-  bool fake_promise = false;
-  // Put the function pointer and all arguments into a tuple
-  auto* func_and_args = new std::tuple<decltype(fn), std::tuple<Args...>, bool*>(fn, std::forward_as_tuple(args...), &fake_promise);
+template <typename Fn, typename... Args>
+env::Thread make_thread(Fn&& fn, Args&&... args) {
+  using Launch = internal::Launch<typename std::decay<Fn>::type, typename std::decay<Args>::type...>;
+  Launch launch(std::forward<Fn>(fn), std::forward<Args>(args)...);
   // Create a thread that runs the function wrapper
-  env::Thread internal_thread = env::Thread(internal::wrap_func_<decltype(fn), Args...>, (void*)func_and_args);
-  // Wait for thread initialization
-  while (!fake_promise) {
-    env::sleep_for(1);
-  }
+  env::Thread internal_thread = env::Thread(
+    internal::launch_entry_<typename std::decay<Fn>::type, typename std::decay<Args>::type...>,
+    static_cast<void*>(&launch)
+  );
+  // Wait for thread initialization, so that the launch outlives its use; vex STL is also buggy with threads that haven't started
+  launch.started.wait();
   return internal_thread;
 }
 
@@ -98,16 +120,424 @@ Ret static_proxy(Cls* cls_instance, Ret (Cls::*cls_fn)(Args...), Args... args) {
  * Creates a env::Thread that runs a member function with arguments
  * @tparam Cls type of `cls_instance`
  * @tparam Ret return type of `cls_fn`
- * @tparam Args types of arguments to `cls_fn`
+ * @tparam Params types of the parameters of `cls_fn`
+ * @tparam Args types of arguments passed to `cls_fn`
  * @param cls_instance pointer to instance of class to run `cls_fn` on
  * @param cls_fn pointer to function callable from `cls_instance`; i.e., `&Cls::some_function`
  * @param args arguments to `cls_fn`
  * @return env::Thread that is running `cls_fn`
  */
-template <typename Cls, typename Ret, typename... Args>
-env::Thread make_member_thread(Cls* cls_instance, Ret (Cls::*cls_fn)(Args...), Args... args) {
-  return make_thread(static_proxy<Cls, Ret, Args...>, cls_instance, cls_fn, std::forward<Args>(args)...);
+template <typename Cls, typename Ret, typename... Params, typename... Args>
+env::Thread make_member_thread(Cls* cls_instance, Ret (Cls::*cls_fn)(Params...), Args&&... args) {
+  return make_thread(static_proxy<Cls, Ret, Params...>, cls_instance, cls_fn, std::forward<Args>(args)...);
 }
 
+/**
+ * A flag that threads can wait on until another thread sets it.
+ *
+ * Setting and checking the flag are single atomic operations, so an event can be set from the tracking loop (or any
+ * other thread that can't block) to wake threads waiting on it. The flag stays set until it is cleared.
+ */
+class Event {
+public:
+  Event(bool set = false);
+
+  Event(const Event&) = delete;
+  Event& operator=(const Event&) = delete;
+
+  /** Sets the flag, waking every thread waiting on it. */
+  void set();
+
+  /** Clears the flag. */
+  void clear();
+
+  /** @return True if the flag is set. */
+  bool is_set() const;
+
+  /**
+   * Blocks the current thread until the flag is set.
+   * @param timeout The maximum time to wait in milliseconds. A timeout of 0 waits indefinitely.
+   * @return True if the flag was set, false if the timeout passed first.
+   */
+  bool wait(uint32_t timeout = 0);
+
+  /**
+   * Clears the flag if it is set, so that each time the event is set is only handled by one waiter.
+   * @return True if the flag was set.
+   */
+  bool consume();
+
+private:
+  std::atomic<bool> flag;
+  env::Notifier notifier;
+};
+
+/**
+ * A bounded lock-free queue for passing values from one thread to another.
+ *
+ * Only one thread may push and only one thread may pop at a time. Pushing and popping never block or allocate,
+ * so this can carry data into or out of the tracking loop.
+ * @tparam T the type of value in the queue. Must be default constructible, since every slot is constructed up front.
+ */
+template <typename T>
+class SpscQueue {
+public:
+  /**
+   * Creates an empty queue.
+   * @param capacity The minimum number of values that the queue can hold. Rounded up to a power of two.
+   */
+  explicit SpscQueue(std::size_t capacity) : head(0), tail(0) {
+    std::size_t size = 1;
+    while (size < capacity) { size <<= 1; }
+
+    cells.reset(new T[size]);
+    mask = size - 1;
+  }
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  /**
+   * Adds a value to the back of the queue. Only called from the producing thread.
+   * @return True if the value was added, false if the queue is full.
+   */
+  bool try_push(const T& value) { return emplace(value); }
+  bool try_push(T&& value) { return emplace(std::move(value)); }
+
+  /**
+   * Removes the value at the front of the queue. Only called from the consuming thread.
+   * @param value Set to the removed value.
+   * @return True if a value was removed, false if the queue is empty.
+   */
+  bool try_pop(T& value) {
+    std::size_t position = head.load(std::memory_order_relaxed);
+    if (position == tail.load(std::memory_order_acquire)) return false;
+
+    value = std::move(cells[position & mask]);
+    head.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** @return The number of values in the queue, which may already be out of date if the other thread is using it. */
+  std::size_t size() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+
+  bool empty() const { return size() == 0; }
+
+  std::size_t capacity() const { return mask + 1; }
+
+private:
+  template <typename U>
+  bool emplace(U&& value) {
+    std::size_t position = tail.load(std::memory_order_relaxed);
+    if (position - head.load(std::memory_order_acquire) > mask) return false;
+
+    cells[position & mask] = std::forward<U>(value);
+    tail.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::unique_ptr<T[]> cells;
+  std::size_t mask;
+
+  // The position of the next value to pop (written only by the consumer) and push (written only by the producer).
+  std::atomic<std::size_t> head;
+  std::atomic<std::size_t> tail;
+};
+
+/**
+ * A bounded lock-free queue that any number of threads can push values into.
+ *
+ * Each slot carries a sequence number that tells producers and consumers whose turn it is to use it, so claiming a
+ * slot only takes a single compare-and-swap and no thread ever waits on a lock held by another. Based on Dmitry
+ * Vyukov's bounded MPMC queue, so several threads may also pop at once, which lets producers evict the oldest value
+ * when the queue is full.
+ * @tparam T the type of value in the queue. Must be default constructible, since every slot is constructed up front.
+ */
+template <typename T>
+class MpscQueue {
+public:
+  /**
+   * Creates an empty queue.
+   * @param capacity The minimum number of values that the queue can hold. Rounded up to a power of two.
+   */
+  explicit MpscQueue(std::size_t capacity) {
+    std::size_t size = 1;
+    while (size < capacity) { size <<= 1; }
+
+    cells.reset(new Cell[size]);
+    mask = size - 1;
+
+    for (std::size_t i = 0; i < size; i++) {
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    enqueue_position.store(0, std::memory_order_relaxed);
+    dequeue_position.store(0, std::memory_order_relaxed);
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  /**
+   * Adds a value to the back of the queue.
+   * @return True if the value was added, false if the queue is full.
+   */
+  bool try_push(const T& value) { return emplace(value); }
+  bool try_push(T&& value) { return emplace(std::move(value)); }
+
+  /**
+   * Removes the value at the front of the queue.
+   * @param value Set to the removed value.
+   * @return True if a value was removed, false if the queue is empty.
+   */
+  bool try_pop(T& value) {
+    Cell* cell;
+    std::size_t position = dequeue_position.load(std::memory_order_relaxed);
+
+    while (true) {
+      cell = &cells[position & mask];
+      std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+
+      if (difference == 0) {
+        if (dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+      } else if (difference < 0) {
+        return false; // empty
+      } else {
+        position = dequeue_position.load(std::memory_order_relaxed);
+      }
+    }
+
+    value = std::move(cell->value);
+    cell->sequence.store(position + mask + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  std::size_t capacity() const { return mask + 1; }
+
+private:
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  template <typename U>
+  bool emplace(U&& value) {
+    Cell* cell;
+    std::size_t position = enqueue_position.load(std::memory_order_relaxed);
+
+    while (true) {
+      cell = &cells[position & mask];
+      std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+      if (difference == 0) {
+        if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+      } else if (difference < 0) {
+        return false; // full
+      } else {
+        position = enqueue_position.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->value = std::forward<U>(value);
+    cell->sequence.store(position + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  std::unique_ptr<Cell[]> cells;
+  std::size_t mask;
+
+  std::atomic<std::size_t> enqueue_position;
+  std::atomic<std::size_t> dequeue_position;
+};
+
+/**
+ * Shares a value written by one thread with any number of reading threads, without readers ever blocking the writer.
+ *
+ * The writer bumps a sequence number before and after each write. Readers copy the value and retry if the sequence
+ * number was odd (a write was in progress) or changed while they were copying, so they always see a whole value.
+ * @tparam T the type of the value. Must be trivially copyable, since readers may copy it while it's being written.
+ * @attention Only one thread may write at a time. A reader with a higher priority than the writer should use
+ * try_load() from real-time code, since a writer interrupted partway through can't finish until the reader sleeps.
+ */
+template <typename T>
+class SeqLock {
+public:
+  SeqLock() : sequence(0), value() {}
+  explicit SeqLock(const T& value) : sequence(0), value(value) {}
+
+  // Copying takes a snapshot of the other's current value, so that classes holding a seqlock stay copyable.
+  SeqLock(const SeqLock& other) : sequence(0), value(other.load()) {}
+  SeqLock& operator=(const SeqLock&) = delete;
+
+  /**
+   * Replaces the value. Only called from the writing thread.
+   * @param new_value The new value.
+   */
+  void store(const T& new_value) {
+    uint32_t current = sequence.load(std::memory_order_relaxed);
+    sequence.store(current + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    value = new_value;
+
+    sequence.store(current + 2, std::memory_order_release);
+  }
+
+  /**
+   * Copies the value, retrying until a write isn't in the way.
+   * @return The most recently stored value.
+   */
+  T load() const {
+    T result;
+    for (uint32_t attempt = 0; !try_load(result); attempt++) {
+      if (attempt < SPIN_ATTEMPTS) {
+        env::thread_yield();
+      } else {
+        env::sleep_for(1);
+      }
+    }
+    return result;
+  }
+
+  /**
+   * Copies the value, unless a write is in progress.
+   * @param result Set to the most recently stored value if successful.
+   * @return True if the value was copied, false if it was being written.
+   */
+  bool try_load(T& result) const {
+    uint32_t before = sequence.load(std::memory_order_acquire);
+    if (before & 1) return false;
+
+    T copy = value;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence.load(std::memory_order_relaxed) != before) return false;
+
+    result = copy;
+    return true;
+  }
+
+  /** @return The number of times the value has been stored. */
+  uint32_t version() const { return sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+  // Readers that keep colliding with writes stop yielding and sleep, so that a lower priority writer can finish.
+  static constexpr uint32_t SPIN_ATTEMPTS = 16;
+
+  std::atomic<uint32_t> sequence;
+  T value;
+};
+
+/**
+ * Runs periodic tasks on a small pool of threads, rather than giving each periodic loop its own thread.
+ *
+ * Each task has a period, a deadline and a priority. Whenever a worker thread is free, it runs the task
+ * that is due with the earliest deadline (ties are broken by priority), then sleeps until the next task
+ * is released. Tasks are released on a fixed schedule, so time spent running them doesn't cause drift.
+ *
+ * Tasks should return quickly and must not block, since a blocked task holds up every other task waiting
+ * on the same worker. A task never runs on two workers at once.
+ */
+class TaskScheduler {
+public:
+  /** A function run by the scheduler every period. */
+  using Task = std::function<void()>;
+
+  /** Timing of a single task. All durations are in microseconds. */
+  struct Stats {
+    /** Number of times the task has run. */
+    uint32_t runs;
+
+    /** Number of runs that finished after their deadline. */
+    uint32_t overruns;
+
+    /** Number of releases that were skipped because the task fell more than a full period behind. */
+    uint32_t skipped;
+
+    /** Time from when each run was released until it started. */
+    profiling::Histogram::Stats jitter;
+
+    /** Time spent running the task. */
+    profiling::Histogram::Stats duration;
+  };
+
+  /**
+   * Creates a scheduler. Worker threads aren't started until start() is called.
+   * @param thread_count The number of worker threads. One is enough unless a task runs for longer than others can wait.
+   * @param thread_priority The priority of each worker thread.
+   */
+  TaskScheduler(std::size_t thread_count = 1, int32_t thread_priority = env::THREAD_PRIORITY_NORMAL);
+  ~TaskScheduler();
+
+  TaskScheduler(const TaskScheduler&) = delete;
+  TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+  /**
+   * Registers a periodic task. Tasks can be added before or after the scheduler is started, and first run immediately.
+   * @param name A name for the task, used in traces. Stored by pointer, so it should be a string literal.
+   * @param period The time between each run in milliseconds.
+   * @param task The function to run.
+   * @param priority Breaks ties between tasks with the same deadline (higher runs first).
+   * @param deadline The time in milliseconds after each release that the task must finish by. Defaults to its period.
+   * @return An id for the task, or -1 if the period is zero.
+   */
+  int32_t add_task(const char* name, uint32_t period, const Task& task, int32_t priority = 0, uint32_t deadline = 0);
+
+  /**
+   * Stops running a task. If the task is currently running, it finishes its current run.
+   * @param id The id returned by add_task().
+   */
+  void remove_task(int32_t id);
+
+  /** Starts the worker threads. */
+  void start();
+
+  /** Stops the worker threads, waiting for any running tasks to finish. */
+  void stop();
+
+  /**
+   * Gets timing stats for a task.
+   * @param id The id returned by add_task().
+   * @return The task's stats, or all zeros if the id isn't valid.
+   */
+  Stats get_stats(int32_t id);
+
+private:
+  struct Entry {
+    const char* name;
+    Task task;
+    uint32_t period, deadline;
+    int32_t priority;
+
+    // Time that the current run was released, in microseconds since the scheduler was created.
+    int64_t release;
+
+    bool running, removed;
+
+    uint32_t runs, overruns, skipped;
+    profiling::Histogram jitter, duration;
+  };
+
+  // Entries are never moved once added, so a worker can run one without holding the lock.
+  std::vector<std::unique_ptr<Entry>> entries;
+  env::Mutex mutex;
+  env::Timer timer;
+
+  std::size_t thread_count;
+  int32_t thread_priority;
+  std::vector<std::shared_ptr<env::Thread>> threads;
+  bool active = false;
+
+  // The longest time (in milliseconds) that an idle worker sleeps before checking for new tasks.
+  static constexpr uint32_t MAX_IDLE_SLEEP = 10;
+
+  int worker();
+  Entry* next_entry(int64_t now, int64_t& next_release);
+};
+
 } // namespace threading
 } // namespace tao
\ No newline at end of file
@@ -0,0 +1,142 @@
+/**
+ * @file src/taolib/trace.h
+ * @author Tropical
+ *
+ * Timeline of events across every thread, exported in the Chrome trace event format.
+ *
+ * Events are begin/end pairs (such as a tick of the tracking loop, or a thread waiting on a
+ * mutex), instants, and asynchronous spans that can start and end on different threads (such
+ * as a movement). Each event is timestamped in microseconds and written into a preallocated
+ * buffer without taking a lock, so tracing can stay on while the robot runs.
+ *
+ * Dumps can be opened in chrome://tracing or https://ui.perfetto.dev to see what every thread
+ * was doing over time, which makes lock contention and priority inversions visible.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Determines if tracing is compiled into the program (enabled by default).
+ * Defining `TAO_TRACING=0` removes every TAO_TRACE_* macro entirely. Otherwise, events are
+ * only recorded between calls to trace::start() and trace::stop().
+ */
+#ifndef TAO_TRACING
+#define TAO_TRACING 1
+#endif
+
+#ifndef DOXYGEN_IGNORE
+#define TAO_TRACE_CONCAT_INNER_(a, b) a##b
+#define TAO_TRACE_CONCAT_(a, b) TAO_TRACE_CONCAT_INNER_(a, b)
+#endif /* DOXYGEN_IGNORE */
+
+#if TAO_TRACING
+/** Records a span on the current thread from this point until the end of the enclosing scope. */
+#define TAO_TRACE_SCOPE(name) ::tao::trace::Scope TAO_TRACE_CONCAT_(tao_trace_scope_, __LINE__)(name)
+
+/** Records the start or end of a span on the current thread, for spans that don't line up with a scope. */
+#define TAO_TRACE_BEGIN(name) ::tao::trace::begin(name)
+#define TAO_TRACE_END(name) ::tao::trace::end(name)
+
+/** Records a single point in time on the current thread. */
+#define TAO_TRACE_INSTANT(name) ::tao::trace::instant(name)
+
+/** Starts or ends a span that isn't tied to one thread, identified by its name and id. */
+#define TAO_TRACE_ASYNC_BEGIN(name, id) ::tao::trace::async_begin(name, id)
+#define TAO_TRACE_ASYNC_END(name, id) ::tao::trace::async_end(name, id)
+
+/** Names the current thread in the timeline. */
+#define TAO_TRACE_THREAD_NAME(name) ::tao::trace::set_thread_name(name)
+#else
+#define TAO_TRACE_SCOPE(name) do {} while (0)
+#define TAO_TRACE_BEGIN(name) do {} while (0)
+#define TAO_TRACE_END(name) do {} while (0)
+#define TAO_TRACE_INSTANT(name) do {} while (0)
+#define TAO_TRACE_ASYNC_BEGIN(name, id) do {} while (0)
+#define TAO_TRACE_ASYNC_END(name, id) do {} while (0)
+#define TAO_TRACE_THREAD_NAME(name) do {} while (0)
+#endif
+
+namespace tao {
+namespace trace {
+
+/**
+ * Allocates the trace buffer and starts recording events.
+ * Recording stops once the buffer is full, and any further events are counted as dropped.
+ * @param capacity The maximum number of events to record. Each event takes 20 bytes on the brain.
+ * @return True if tracing was started, false if it was already running.
+ */
+bool start(std::size_t capacity = 16384);
+
+/**
+ * Stops recording events, waiting for any events that are being written to finish.
+ * The recorded events are kept until tracing is started again.
+ */
+void stop();
+
+bool is_active();
+
+/** @return The number of events recorded since tracing started. */
+std::size_t size();
+
+/** @return The number of events that didn't fit in the buffer. */
+uint32_t dropped();
+
+/**
+ * Names the current thread. Names are kept across calls to start(), so threads can be named before tracing starts.
+ * @attention Names are stored by pointer, so they should be string literals.
+ * @param name The name shown for the thread.
+ */
+void set_thread_name(const char* name);
+
+/**
+ * Records the start or end of a span on the current thread. Spans can be nested, but must end in the reverse order that
+ * they began in. TAO_TRACE_SCOPE should usually be used instead.
+ * @attention Names are stored by pointer, so they should be string literals.
+ * @param name The name of the span.
+ */
+void begin(const char* name);
+void end(const char* name);
+
+/**
+ * Records a single point in time on the current thread.
+ * @param name The name of the event.
+ */
+void instant(const char* name);
+
+/**
+ * Records the start or end of a span that may begin and end on different threads.
+ * @param name The name of the span.
+ * @param id A number identifying this span among others with the same name.
+ */
+void async_begin(const char* name, uint32_t id);
+void async_end(const char* name, uint32_t id);
+
+/**
+ * Writes every recorded event to a file as Chrome trace event JSON.
+ * Events are formatted into a fixed buffer and written in chunks, so dumping doesn't allocate.
+ * @param path The path of the file, relative to the root of the SD card (or the working directory on a computer).
+ * @return True if every event was written, false otherwise.
+ */
+bool dump(const char* path);
+
+/**
+ * Records a span from its construction to its destruction.
+ * Usually created through TAO_TRACE_SCOPE, so that it can be compiled out.
+ */
+class Scope {
+public:
+	Scope(const char* name) : name(name) { begin(name); }
+	~Scope() { end(name); }
+
+	Scope(const Scope&) = delete;
+	Scope& operator=(const Scope&) = delete;
+
+private:
+	const char* name;
+};
+
+} // namespace trace
+} // namespace tao
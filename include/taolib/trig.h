@@ -0,0 +1,182 @@
+/**
+ * @file src/taolib/trig.h
+ * @author Tropical
+ *
+ * Fast sine, cosine and arctangent for the tracking loop.
+ *
+ * The brain's libm computes double precision trig in software, with full argument reduction and special case handling
+ * that the tracking loop never needs. These versions reduce the angle once (with a short two or three-part reduction
+ * by pi/2), evaluate a fixed polynomial, and are defined inline so they can be optimized into their callers. Sine and
+ * cosine of the same angle are usually needed together (such as when rotating a vector), so sincos() computes both
+ * from a single reduction.
+ *
+ * Each function comes in double and float versions. The maximum absolute errors against a long double libm, measured
+ * with tools/trig_benchmark.cpp, are:
+ *
+ * | Function      | double                          | float                           |
+ * | ------------- | ------------------------------- | ------------------------------- |
+ * | sin, cos      | 2e-16 (for \|x\| <= 1e5 radians)  | 2e-7 (for \|x\| <= 1e3 radians)   |
+ * | atan2         | 5e-16                           | 3e-7                            |
+ *
+ * Outside of those ranges, the reduction loses precision gradually, like a plain `x - k * pi/2` would. Infinite and
+ * NaN inputs give unspecified results.
+ */
+
+#pragma once
+
+#include <cmath>
+
+namespace tao {
+namespace math {
+
+/** The sine and cosine of an angle. */
+template <typename T>
+struct SinCos {
+	T sin, cos;
+};
+
+#ifndef DOXYGEN_IGNORE
+namespace internal {
+
+// pi/2 split into parts whose products with the quadrant number are exact, so the reduced angle keeps its precision.
+// The double split is from fdlibm (33 bits plus the remainder), and the float split is 8 bits, 12 bits and the remainder.
+constexpr double PIO2_HI = 1.57079632673412561417e+00;
+constexpr double PIO2_LO = 6.07710050650619224932e-11;
+constexpr double TWO_OVER_PI = 6.36619772367581382433e-01;
+
+constexpr float PIO2_HI_F = 1.5703125f;
+constexpr float PIO2_MID_F = 4.838705062866211e-4f;
+constexpr float PIO2_LO_F = -4.371139000186243e-8f;
+constexpr float TWO_OVER_PI_F = 6.3661977236e-01f;
+
+// Minimax polynomials for sin and cos on [-pi/4, pi/4] (from fdlibm's __kernel_sin and __kernel_cos).
+inline double sin_kernel(double r) {
+	double z = r * r;
+	return r + r * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 + z * (-1.98412698298579493134e-04
+		+ z * (2.75573137070700676789e-06 + z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+}
+
+inline double cos_kernel(double r) {
+	double z = r * r;
+	return 1.0 - 0.5 * z + z * z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 + z * (2.48015872894767294178e-05
+		+ z * (-2.75573143513906633035e-07 + z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11)))));
+}
+
+// Taylor polynomials are already below float rounding error on [-pi/4, pi/4].
+inline float sin_kernel(float r) {
+	float z = r * r;
+	return r + r * z * (-1.0f / 6.0f + z * (1.0f / 120.0f + z * (-1.0f / 5040.0f + z * (1.0f / 362880.0f))));
+}
+
+inline float cos_kernel(float r) {
+	float z = r * r;
+	return 1.0f - 0.5f * z + z * z * (1.0f / 24.0f + z * (-1.0f / 720.0f + z * (1.0f / 40320.0f)));
+}
+
+// Minimax polynomials for atan on [-7/16, 7/16] (from fdlibm's atan and atanf).
+inline double atan_kernel(double x) {
+	double z = x * x;
+	double w = z * z;
+	double odd = z * (3.33333333333329318027e-01 + w * (1.42857142725034663711e-01 + w * (9.09088713343650656196e-02
+		+ w * (6.66107313738753120669e-02 + w * (4.97687799461593236017e-02 + w * 1.62858201153657823623e-02)))));
+	double even = w * (-1.99999999998764832476e-01 + w * (-1.11111104054623557880e-01 + w * (-7.69187620504482999495e-02
+		+ w * (-5.83357013379057348645e-02 + w * -3.65315727442169155270e-02))));
+	return x - x * (odd + even);
+}
+
+inline float atan_kernel(float x) {
+	float z = x * x;
+	float w = z * z;
+	float odd = z * (3.3333328366e-01f + w * (1.4253635705e-01f + w * 6.1687607318e-02f));
+	float even = w * (-1.9999158382e-01f + w * -1.0648017377e-01f);
+	return x - x * (odd + even);
+}
+
+// Picks sin and cos of the original angle from those of the reduced angle, based on its quadrant. This is written
+// with selects rather than a switch, since the quadrant is hard to predict.
+template <typename T>
+inline SinCos<T> from_quadrant(T sin_r, T cos_r, long quadrant) {
+	T sin = (quadrant & 1) ? cos_r : sin_r;
+	T cos = (quadrant & 1) ? sin_r : cos_r;
+
+	// Sine is negative in quadrants 2 and 3, and cosine is negative in quadrants 1 and 2.
+	return { (quadrant & 2) ? -sin : sin, ((quadrant + 1) & 2) ? -cos : cos };
+}
+
+template <typename T>
+inline T atan2(T y, T x, T pi, T tan_pi_8) {
+	T abs_y = std::abs(y);
+	T abs_x = std::abs(x);
+
+	// Reduce to an angle between 0 and pi/4 (the smaller component over the larger one), then to one within pi/8 of 0.
+	bool swapped = abs_y > abs_x;
+	T numerator = swapped ? abs_x : abs_y;
+	T denominator = swapped ? abs_y : abs_x;
+	if (denominator == 0) return 0;
+
+	T angle;
+	if (numerator > tan_pi_8 * denominator) {
+		angle = pi / 4 + atan_kernel((numerator - denominator) / (numerator + denominator));
+	} else {
+		angle = atan_kernel(numerator / denominator);
+	}
+
+	if (swapped) angle = pi / 2 - angle;
+	if (x < 0) angle = pi - angle;
+	return y < 0 ? -angle : angle;
+}
+
+} // namespace internal
+#endif /* DOXYGEN_IGNORE */
+
+/**
+ * Calculates the sine and cosine of an angle together.
+ * @param radians The angle in radians.
+ * @return The sine and cosine of the angle.
+ */
+inline SinCos<double> sincos(double radians) {
+	long quadrant = static_cast<long>(radians * internal::TWO_OVER_PI + std::copysign(0.5, radians));
+	double k = static_cast<double>(quadrant);
+	double r = (radians - k * internal::PIO2_HI) - k * internal::PIO2_LO;
+
+	return internal::from_quadrant(internal::sin_kernel(r), internal::cos_kernel(r), quadrant);
+}
+
+inline SinCos<float> sincos(float radians) {
+	long quadrant = static_cast<long>(radians * internal::TWO_OVER_PI_F + std::copysign(0.5f, radians));
+	float k = static_cast<float>(quadrant);
+	float r = ((radians - k * internal::PIO2_HI_F) - k * internal::PIO2_MID_F) - k * internal::PIO2_LO_F;
+
+	return internal::from_quadrant(internal::sin_kernel(r), internal::cos_kernel(r), quadrant);
+}
+
+/**
+ * Calculates the sine of an angle.
+ * @param radians The angle in radians.
+ */
+inline double fast_sin(double radians) { return sincos(radians).sin; }
+inline float fast_sin(float radians) { return sincos(radians).sin; }
+
+/**
+ * Calculates the cosine of an angle.
+ * @param radians The angle in radians.
+ */
+inline double fast_cos(double radians) { return sincos(radians).cos; }
+inline float fast_cos(float radians) { return sincos(radians).cos; }
+
+/**
+ * Calculates the angle of a point from the origin, like std::atan2.
+ * @param y The y coordinate of the point.
+ * @param x The x coordinate of the point.
+ * @return The angle in radians, between -pi and pi. The angle of the origin itself is 0.
+ */
+inline double fast_atan2(double y, double x) {
+	return internal::atan2(y, x, 3.14159265358979323846, 0.41421356237309504880);
+}
+
+inline float fast_atan2(float y, float x) {
+	return internal::atan2(y, x, 3.14159265f, 0.41421356f);
+}
+
+} // namespace math
+} // namespace tao
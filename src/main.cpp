@@ -9,6 +9,8 @@ vex::motor_group right_drive(back_right_drive);
 
 vex::inertial imu(vex::PORT9);
 
+tao::Logger logger(std::cout, tao::Logger::Level::DEBUG);
+
 auto drivetrain = tao::DifferentialDrivetrain(left_drive, right_drive, imu, {
 	.drive_gains = { 3.24, 0.05, 0.125, 0 },
 	.turn_gains = { 2.75, 0, 0.32, 0 },
@@ -18,12 +20,16 @@ auto drivetrain = tao::DifferentialDrivetrain(left_drive, right_drive, imu, {
 	.track_width = 11.6,
 	.wheel_diameter = 4,
 	.gearing = (1.0 / 1.0)
-}, tao::Logger(std::cout, tao::Logger::Level::DEBUG));
+}, logger);
 
 int main() {	
 	using tao::Vector2;
 
-	// drivetrain.calibrate_imu();
+	// Write log output from a background thread so serial output never stalls the tracking loop.
+	logger.start_async();
+
+	// Calibration runs in the background, so tracking can start right away using wheel heading.
+	// drivetrain.calibrate_imu(false);
 	drivetrain.start_tracking();
 
 	// drivetrain.move_to(Vector2(24, 24));
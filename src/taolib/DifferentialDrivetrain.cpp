@@ -14,6 +14,7 @@
 #include <iostream>
 #include <cstdint>
 #include <utility>
+#include <algorithm>
 
 #include "taolib/env.h"
 
@@ -21,7 +22,10 @@
 #include "taolib/PIDController.h"
 #include "taolib/Vector2.h"
 #include "taolib/math.h"
+#include "taolib/geometry.h"
+#include "taolib/trig.h"
 #include "taolib/threading.h"
+#include "taolib/RateScheduler.h"
 
 namespace tao {
 
@@ -43,9 +47,18 @@ DifferentialDrivetrain::DifferentialDrivetrain(env::MotorGroup& left_motors,
 	  track_width(config.track_width),
 	  wheel_diameter(config.wheel_diameter),
 	  gearing(config.gearing),
-	  logger(logger) {
+	  max_velocity(config.max_velocity),
+	  stall_time(config.stall_time),
+	  stall_velocity(config.stall_velocity),
+	  collision_acceleration(config.collision_acceleration),
+	  logger(logger),
+	  config_snapshot(Tunables{ config, max_drive_power, max_turn_power }) {
 	drive_controller.set_gains(config.drive_gains);
 	turn_controller.set_gains(config.turn_gains);
+	left_velocity_controller.set_gains(config.velocity_gains);
+	right_velocity_controller.set_gains(config.velocity_gains);
+	left_feedforward.set_gains(config.left_feedforward);
+	right_feedforward.set_gains(config.right_feedforward);
 }
 
 DifferentialDrivetrain::DifferentialDrivetrain(env::MotorGroup& left_motors,
@@ -63,9 +76,18 @@ DifferentialDrivetrain::DifferentialDrivetrain(env::MotorGroup& left_motors,
 	  track_width(config.track_width),
 	  wheel_diameter(config.wheel_diameter),
 	  gearing(config.gearing),
-	  logger(logger) {
+	  max_velocity(config.max_velocity),
+	  stall_time(config.stall_time),
+	  stall_velocity(config.stall_velocity),
+	  collision_acceleration(config.collision_acceleration),
+	  logger(logger),
+	  config_snapshot(Tunables{ config, max_drive_power, max_turn_power }) {
 	drive_controller.set_gains(config.drive_gains);
 	turn_controller.set_gains(config.turn_gains);
+	left_velocity_controller.set_gains(config.velocity_gains);
+	right_velocity_controller.set_gains(config.velocity_gains);
+	left_feedforward.set_gains(config.left_feedforward);
+	right_feedforward.set_gains(config.right_feedforward);
 }
 
 DifferentialDrivetrain::DifferentialDrivetrain(env::MotorGroup& left_motors,
@@ -86,9 +108,18 @@ DifferentialDrivetrain::DifferentialDrivetrain(env::MotorGroup& left_motors,
 	  track_width(config.track_width),
 	  wheel_diameter(config.wheel_diameter),
 	  gearing(config.gearing),
-	  logger(logger) {
+	  max_velocity(config.max_velocity),
+	  stall_time(config.stall_time),
+	  stall_velocity(config.stall_velocity),
+	  collision_acceleration(config.collision_acceleration),
+	  logger(logger),
+	  config_snapshot(Tunables{ config, max_drive_power, max_turn_power }) {
 	drive_controller.set_gains(config.drive_gains);
 	turn_controller.set_gains(config.turn_gains);
+	left_velocity_controller.set_gains(config.velocity_gains);
+	right_velocity_controller.set_gains(config.velocity_gains);
+	left_feedforward.set_gains(config.left_feedforward);
+	right_feedforward.set_gains(config.right_feedforward);
 }
 
 DifferentialDrivetrain::DifferentialDrivetrain(env::MotorGroup& left_motors,
@@ -108,55 +139,66 @@ DifferentialDrivetrain::DifferentialDrivetrain(env::MotorGroup& left_motors,
 	  track_width(config.track_width),
 	  wheel_diameter(config.wheel_diameter),
 	  gearing(config.gearing),
-	  logger(logger) {
+	  max_velocity(config.max_velocity),
+	  stall_time(config.stall_time),
+	  stall_velocity(config.stall_velocity),
+	  collision_acceleration(config.collision_acceleration),
+	  logger(logger),
+	  config_snapshot(Tunables{ config, max_drive_power, max_turn_power }) {
   drive_controller.set_gains(config.drive_gains);
   turn_controller.set_gains(config.turn_gains);
+  left_velocity_controller.set_gains(config.velocity_gains);
+  right_velocity_controller.set_gains(config.velocity_gains);
+  left_feedforward.set_gains(config.left_feedforward);
+  right_feedforward.set_gains(config.right_feedforward);
 }
 
-DifferentialDrivetrain::~DifferentialDrivetrain() { stop_tracking(); }
+DifferentialDrivetrain::~DifferentialDrivetrain() {
+	stop_tracking();
+
+	if (calibration_thread != nullptr) {
+		calibration_thread->join();
+		calibration_thread = nullptr;
+	}
+}
 
 // Getters
 
 Vector2 DifferentialDrivetrain::get_position() {
-	mutex.lock();
+	lock_mutex();
 	Vector2 position = this->position;
 	mutex.unlock();
 	return position;
 }
-PIDController::Gains DifferentialDrivetrain::get_drive_gains() const { return drive_controller.get_gains(); }
-PIDController::Gains DifferentialDrivetrain::get_turn_gains() const { return turn_controller.get_gains(); }
+PIDController::Gains DifferentialDrivetrain::get_drive_gains() const { return config_snapshot.load().config.drive_gains; }
+PIDController::Gains DifferentialDrivetrain::get_turn_gains() const { return config_snapshot.load().config.turn_gains; }
+PIDController::Gains DifferentialDrivetrain::get_velocity_gains() const { return config_snapshot.load().config.velocity_gains; }
 double DifferentialDrivetrain::get_drive_error() {
-	mutex.lock();
+	lock_mutex();
 	double drive_error = this->drive_error;
 	mutex.unlock();
 	return drive_error;
 }
 double DifferentialDrivetrain::get_turn_error() {
-	mutex.lock();
+	lock_mutex();
 	double turn_error = this->turn_error;
 	mutex.unlock();
 	return turn_error;
 }
-double DifferentialDrivetrain::get_max_drive_power() const { return max_drive_power; }
-double DifferentialDrivetrain::get_max_turn_power() const { return max_turn_power; }
-double DifferentialDrivetrain::get_drive_tolerance() const { return drive_tolerance; }
-double DifferentialDrivetrain::get_turn_tolerance() const { return turn_tolerance; }
-double DifferentialDrivetrain::get_track_width() const { return track_width; }
-double DifferentialDrivetrain::get_lookahead_distance() const { return lookahead_distance; }
-double DifferentialDrivetrain::get_gearing() const { return gearing; }
-double DifferentialDrivetrain::get_wheel_diameter() const { return wheel_diameter; }
-DifferentialDrivetrain::Config DifferentialDrivetrain::get_config() const {
-	return {
-		drive_controller.get_gains(),
-		turn_controller.get_gains(),
-		drive_tolerance,
-		turn_tolerance,
-		track_width,
-		lookahead_distance,
-		wheel_diameter,
-		gearing
-	};
+double DifferentialDrivetrain::get_max_drive_power() const { return config_snapshot.load().max_drive_power; }
+double DifferentialDrivetrain::get_max_turn_power() const { return config_snapshot.load().max_turn_power; }
+double DifferentialDrivetrain::get_max_velocity() const { return config_snapshot.load().config.max_velocity; }
+std::pair<Feedforward::Gains, Feedforward::Gains> DifferentialDrivetrain::get_feedforward_gains() const {
+	Config config = config_snapshot.load().config;
+	return { config.left_feedforward, config.right_feedforward };
 }
+double DifferentialDrivetrain::get_drive_tolerance() const { return config_snapshot.load().config.drive_tolerance; }
+double DifferentialDrivetrain::get_turn_tolerance() const { return config_snapshot.load().config.turn_tolerance; }
+double DifferentialDrivetrain::get_track_width() const { return config_snapshot.load().config.track_width; }
+double DifferentialDrivetrain::get_lookahead_distance() const { return config_snapshot.load().config.lookahead_distance; }
+double DifferentialDrivetrain::get_gearing() const { return config_snapshot.load().config.gearing; }
+double DifferentialDrivetrain::get_wheel_diameter() const { return config_snapshot.load().config.wheel_diameter; }
+DifferentialDrivetrain::Config DifferentialDrivetrain::get_config() const { return config_snapshot.load().config; }
 
 std::pair<double, double> DifferentialDrivetrain::get_wheel_travel() const {
 	double left_rotation, right_rotation;
@@ -176,6 +218,24 @@ std::pair<double, double> DifferentialDrivetrain::get_wheel_travel() const {
 	};
 }
 
+std::pair<double, double> DifferentialDrivetrain::get_wheel_velocities() const {
+	double left_velocity, right_velocity;
+	double wheel_circumference = wheel_diameter * math::PI;
+
+	if (left_encoder != nullptr && right_encoder != nullptr) {
+		left_velocity = env::encoder_get_velocity(*left_encoder);
+		right_velocity = env::encoder_get_velocity(*right_encoder);
+	} else {
+		left_velocity = env::motor_group_get_velocity(left_motors);
+		right_velocity = env::motor_group_get_velocity(right_motors);
+	}
+
+	return {
+		(left_velocity / 360.0) * wheel_circumference * gearing,
+		(right_velocity / 360.0) * wheel_circumference * gearing
+	};
+}
+
 double DifferentialDrivetrain::get_forward_travel() const {
 	std::pair<double, double> wheel_travel = get_wheel_travel();
 	double average = (wheel_travel.first + wheel_travel.second) / 2;
@@ -188,25 +248,56 @@ double DifferentialDrivetrain::get_heading() {
 	// IDEA: check for possible spikes in reported heading due to ESD, then invalidate the imu if detected.
 	if (!imu_invalid && imu != nullptr && !env::imu_is_installed(*imu)) {
 		imu_invalid = true;
-		logger.error("IMU was unplugged. Switching to wheeled heading calculation (less accurate).");
+		TAO_LOG_ERROR(logger, "IMU was unplugged. Switching to wheeled heading calculation (less accurate).");
 	}
 
-	if (imu != nullptr && !imu_invalid) {
+	if (imu_active && !imu_invalid) {
 		// Use the imu-reported imuscope heading if available.
-		return std::fmod((360.0 - env::imu_get_heading(*imu)) + start_heading, 360.0);
+		return std::fmod((360.0 - env::imu_get_heading(*imu)) + imu_heading_offset, 360.0);
 	} else {
-		// If the imu is not available, then find the heading based on only encoders.
-		std::pair<double, double> wheel_travel = get_wheel_travel();
+		// If the imu is not available (or hasn't finished calibrating), then find the heading based on only encoders.
+		return get_wheel_heading();
+	}
+}
 
-		// Unrestricted counterclockwise-facing heading in radians ((right - left) / trackwidth).
-		double raw_heading = (wheel_travel.second - wheel_travel.first) / track_width;
+double DifferentialDrivetrain::get_wheel_heading() const {
+	std::pair<double, double> wheel_travel = get_wheel_travel();
+	return calculate_wheel_heading(wheel_travel.first, wheel_travel.second);
+}
 
-		// Convert to degrees, restrict to 0 <= x < 360, add the user-provided heading offset.
-		return std::fmod(math::to_degrees(raw_heading) + start_heading, 360.0);
-	}
+double DifferentialDrivetrain::calculate_wheel_heading(double left_travel, double right_travel) const {
+	// Unrestricted counterclockwise-facing heading in radians ((right - left) / trackwidth).
+	double raw_heading = (right_travel - left_travel) / track_width;
+
+	// Convert to degrees, restrict to 0 <= x < 360, add the user-provided heading offset.
+	return std::fmod(math::to_degrees(raw_heading) + start_heading, 360.0);
+}
+
+bool DifferentialDrivetrain::is_imu_ready() {
+	return imu != nullptr && !imu_invalid && !imu_calibrating && !env::imu_is_calibrating(*imu);
+}
+
+bool DifferentialDrivetrain::is_imu_calibrated() {
+	lock_mutex();
+	bool calibrated = imu_calibrated;
+	mutex.unlock();
+	return calibrated;
+}
+
+DifferentialDrivetrain::MoveStatus DifferentialDrivetrain::get_move_status() {
+	lock_mutex();
+	MoveStatus status = move_status;
+	mutex.unlock();
+	return status;
+}
+uint32_t DifferentialDrivetrain::get_move_id() {
+	lock_mutex();
+	uint32_t id = move_id;
+	mutex.unlock();
+	return id;
 }
 bool DifferentialDrivetrain::is_settled() {
-	mutex.lock();
+	lock_mutex();
 	bool _settled = settled;
 	mutex.unlock();
 	return _settled;
@@ -214,50 +305,86 @@ bool DifferentialDrivetrain::is_settled() {
 
 // Setters
 
+template <typename Modify>
+void DifferentialDrivetrain::update_config(Modify modify) {
+	config_mutex.lock();
+	Tunables tunables = config_snapshot.load();
+	modify(tunables);
+	config_snapshot.store(tunables);
+	config_mutex.unlock();
+}
+
+void DifferentialDrivetrain::apply_config() {
+	uint32_t version = config_snapshot.version();
+	if (version == applied_config_version) return;
+
+	// If a setter is partway through publishing a new version, it's picked up on the next tick instead.
+	Tunables tunables;
+	if (!config_snapshot.try_load(tunables)) return;
+	applied_config_version = version;
+
+	const Config& config = tunables.config;
+	drive_controller.set_gains(config.drive_gains);
+	turn_controller.set_gains(config.turn_gains);
+	left_velocity_controller.set_gains(config.velocity_gains);
+	right_velocity_controller.set_gains(config.velocity_gains);
+	left_feedforward.set_gains(config.left_feedforward);
+	right_feedforward.set_gains(config.right_feedforward);
+	drive_tolerance = config.drive_tolerance;
+	turn_tolerance = config.turn_tolerance;
+	lookahead_distance = config.lookahead_distance;
+	track_width = config.track_width;
+	wheel_diameter = config.wheel_diameter;
+	gearing = config.gearing;
+	max_velocity = config.max_velocity;
+	stall_time = config.stall_time;
+	stall_velocity = config.stall_velocity;
+	collision_acceleration = config.collision_acceleration;
+	max_drive_power = tunables.max_drive_power;
+	max_turn_power = tunables.max_turn_power;
+}
+
+void DifferentialDrivetrain::set_config(const Config& config) {
+	update_config([&](Tunables& tunables) { tunables.config = config; });
+}
 void DifferentialDrivetrain::set_turn_tolerance(double error) {
-	mutex.lock();
-	turn_tolerance = error;
-	mutex.unlock();
+	update_config([&](Tunables& tunables) { tunables.config.turn_tolerance = error; });
 }
 void DifferentialDrivetrain::set_drive_tolerance(double error) {
-	mutex.lock();
-	drive_tolerance = error;
-	mutex.unlock();
+	update_config([&](Tunables& tunables) { tunables.config.drive_tolerance = error; });
 }
 void DifferentialDrivetrain::set_drive_gains(const PIDController::Gains& gains) {
-	mutex.lock();
-	drive_controller.set_gains(gains);
-	mutex.unlock();
+	update_config([&](Tunables& tunables) { tunables.config.drive_gains = gains; });
 }
 void DifferentialDrivetrain::set_turn_gains(const PIDController::Gains& gains) {
-	mutex.lock();
-	turn_controller.set_gains(gains);
-	mutex.unlock();
+	update_config([&](Tunables& tunables) { tunables.config.turn_gains = gains; });
+}
+void DifferentialDrivetrain::set_velocity_gains(const PIDController::Gains& gains) {
+	update_config([&](Tunables& tunables) { tunables.config.velocity_gains = gains; });
 }
 void DifferentialDrivetrain::set_max_drive_power(double power) {
-	mutex.lock();
-	max_drive_power = power;
-	mutex.unlock();
+	update_config([&](Tunables& tunables) { tunables.max_drive_power = power; });
 }
 void DifferentialDrivetrain::set_max_turn_power(double power) {
-	mutex.lock();
-	max_turn_power = power;
-	mutex.unlock();
+	update_config([&](Tunables& tunables) { tunables.max_turn_power = power; });
+}
+void DifferentialDrivetrain::set_max_velocity(double velocity) {
+	update_config([&](Tunables& tunables) { tunables.config.max_velocity = velocity; });
+}
+void DifferentialDrivetrain::set_feedforward_gains(const Feedforward::Gains& left_gains, const Feedforward::Gains& right_gains) {
+	update_config([&](Tunables& tunables) {
+		tunables.config.left_feedforward = left_gains;
+		tunables.config.right_feedforward = right_gains;
+	});
 }
 void DifferentialDrivetrain::set_lookahead_distance(double distance) {
-	mutex.lock();
-	lookahead_distance = distance;
-	mutex.unlock();
+	update_config([&](Tunables& tunables) { tunables.config.lookahead_distance = distance; });
 }
 void DifferentialDrivetrain::set_gearing(double ratio) {
-	mutex.lock();
-	gearing = ratio;
-	mutex.unlock();
+	update_config([&](Tunables& tunables) { tunables.config.gearing = ratio; });
 }
 void DifferentialDrivetrain::set_wheel_diameter(double diameter) {
-	mutex.lock();
-	wheel_diameter = diameter;
-	mutex.unlock();
+	update_config([&](Tunables& tunables) { tunables.config.wheel_diameter = diameter; });
 }
 
 void DifferentialDrivetrain::set_target(Vector2 position) {
@@ -270,88 +397,351 @@ void DifferentialDrivetrain::set_target(double distance, double heading) {
 	target_heading = heading;
 }
 
+void DifferentialDrivetrain::begin_move(const char* name) {
+	// A movement that hasn't finished yet is replaced by this one.
+	end_move(MoveStatus::Moving);
+
+	current_move = {};
+	current_move.name = name;
+	current_move.start_time = static_cast<uint32_t>(tracking_timer.elapsed());
+	move_errors_measured = false;
+
+	// Each movement is traced as a span from when it's started until it ends.
+	move_id++;
+	TAO_TRACE_ASYNC_BEGIN(name, move_id);
+
+	settled = false;
+	move_status = MoveStatus::Moving;
+	aborted = false;
+	stall_timer = 0;
+}
+
+void DifferentialDrivetrain::abort_move(MoveStatus status) {
+	// Retarget to the current position and heading, so that the aborted movement doesn't resume once
+	// the next one starts, then let blocking movement functions complete.
+	set_target(forward_travel, heading);
+	end_move(status);
+
+	settled = true;
+	move_status = status;
+	aborted = true;
+
+	if (recorder != nullptr && !recording_path.empty()) {
+		recording_dump_pending = true;
+	}
+}
+
+void DifferentialDrivetrain::end_move(MoveStatus status) {
+	if (move_status != MoveStatus::Moving) return;
+
+	TAO_TRACE_ASYNC_END(current_move.name, move_id);
+
+	current_move.end_time = static_cast<uint32_t>(tracking_timer.elapsed());
+	current_move.settle_time = status == MoveStatus::Settled ? current_move.end_time - current_move.start_time : 0;
+	current_move.final_drive_error = drive_error;
+	current_move.final_turn_error = turn_error;
+	current_move.status = status;
+
+	move_history[move_history_count % MOVE_HISTORY_SIZE] = current_move;
+	move_history_count++;
+
+	TAO_LOG_DEBUG(logger, "%s ended (%s) after %.1fms. Overshoot: %f, %f\u00B0",
+		current_move.name, status == MoveStatus::Moving ? "replaced" : move_status_to_string(status), (current_move.end_time - current_move.start_time) / 1000.0,
+		current_move.drive_overshoot, current_move.turn_overshoot);
+}
+
 // Threading
 
+void DifferentialDrivetrain::lock_mutex() {
+	// Time spent waiting on the mutex is traced, which shows contention between the tracking thread and callers.
+	if (mutex.try_lock()) return;
+
+	TAO_TRACE_SCOPE("mutex wait");
+	mutex.lock();
+}
+
 int DifferentialDrivetrain::tracking() {
-	logger.info("Tracking period started.");
+	TAO_TRACE_THREAD_NAME("tracking");
+	TAO_LOG_INFO(logger, "Tracking period started.");
 
-	double previous_forward_travel = 0.0;
-	double previous_heading = 0.0;
+	previous_forward_travel = 0.0;
+	previous_heading = 0.0;
+	settle_counter = 0;
 
-	// Counter representing the amount of cycles that each PID position has been within it's respective min error range.
-	// For example, if the counter reaches 10 then the drivetrain has been within drive_tolerance and turn_tolerance for ~100ms.
-	int32_t settle_counter = 0;
+	tracking_timer.reset();
 
-	// Integrated motor encoders only report at 100hz (once every 10ms).
-	constexpr int32_t SAMPLE_RATE = 10;
+	RateScheduler scheduler;
+	add_tracking_stages(scheduler);
+
+	lock_mutex();
+
+	// Subscribers can be added and removed from other threads at any time, so the publisher is reset under the mutex.
+	telemetry_publisher.reset();
+	frame_sink.reset();
+	telemetry_publisher.subscribe(frame_sink);
+
+	// Stages and ticks overrun if they take longer than a full tick.
+	move_history_count = 0;
+	for (profiling::Histogram& histogram : timings) {
+		histogram.reset();
+		histogram.set_budget(scheduler.get_tick_period() * 1000);
+	}
+	timing(TimingStage::Wakeup).set_budget(WAKEUP_BUDGET);
+	mutex.unlock();
+
+	int64_t previous_tick_start = tracking_timer.elapsed();
 
 	while (tracking_active) {
-		mutex.lock();
-
-		// Measure the current absolute heading and calculate the change in heading from the last loop sample
-		double heading = get_heading();
-		double delta_heading = heading - previous_heading;
-		previous_heading = heading;
-
-		// Measure the forward travel by taking the average value of all encoders.
-		double forward_travel = get_forward_travel();
-		double delta_forward_travel = forward_travel - previous_forward_travel;
-		previous_forward_travel = forward_travel;
-
-		// assume no sideways travel for now.
-		constexpr double delta_sideways_travel = 0.0;
-
-		// Find the average between the current and previous headings
-		// This is useful to know when performing odometry calculations, since
-		// it provides a more accurate estimation of the robot's heading
-		// "during the movement". Simply rotating by the current heading after
-		// the movement would build up error faster.
-		double average_heading = previous_heading + delta_heading / 2.0;
-
-		// Estimate change in global position
-		if (delta_heading == 0.0) {
-			// Fallback estimation to avoid divide-by-zero errors
-			position += Vector2(delta_forward_travel, delta_sideways_travel).rotated(math::to_radians(average_heading));
-		} else {
-			// Using chord length formula
-			position += Vector2(
-				2.0 * (delta_forward_travel / math::to_radians(delta_heading)) * std::sin(math::to_radians(delta_heading / 2)),
-				0.0 // 2.0 * (delta_sideways_travel / math::to_radians(delta_heading)) * std::sin(math::to_radians(delta_heading / 2))
-			).rotated(math::to_radians(average_heading));
+		int64_t tick_start = tracking_timer.elapsed();
+
+#if TAO_PROFILING
+		// Lateness is measured before waiting on the mutex, so that only the wakeup itself is counted.
+		int64_t lateness = scheduler.get_lateness();
+#endif
+
+		TAO_TRACE_BEGIN("tick");
+		lock_mutex();
+
+		TAO_PROFILE_RECORD(timing(TimingStage::Wakeup), static_cast<uint32_t>(lateness > 0 ? lateness : 0));
+
+		// Config changes are picked up before anything else, so the whole tick (and its recording) runs on the same config.
+		apply_config();
+
+		// Commands are recorded before the tick runs, since they're an input to it just like the sensors.
+		FlightRecorder::Record record;
+		if (recorder != nullptr) {
+			record_inputs(record, scheduler.get_tick_count());
 		}
 
-		// Recalculate error for each PID controller.
-		// - If in absolute mode, the error is determined by the robot's distance from a point (the target is an absolute Vector2).
-		// - If in relative mode, the error is determined by a target encoder distance and heading (The target is heading and distance).
-		if (target_type == TargetType::Point) {
-			Vector2 local_target = target_position - position;
+		// Set by the path stage if it aims for a new lookahead point during this tick.
+		path_target_set = false;
 
-			turn_error = math::normalize_degrees(heading - math::to_degrees(local_target.get_angle()));
-			drive_error = local_target.get_magnitude();
+		scheduler.tick();
 
-			// If the turn error exceeds 90 degrees, then the point is behind the
-			// robot, so it's more efficient to travel to the point backwards.
-			if (std::abs(turn_error) >= 90.0) {
-				turn_error = math::normalize_degrees(turn_error - 180.0);
-				drive_error *= -1.0;
-			}
-		} else if (target_type == TargetType::DistanceAndHeading) {
-			turn_error = math::normalize_degrees(heading - target_heading);
-			drive_error = target_distance - forward_travel;
+		if (recorder != nullptr) {
+			record_outputs(record);
+			record.tick_interval = static_cast<uint32_t>(tick_start - previous_tick_start);
+			record.tick_duration = static_cast<uint32_t>(tracking_timer.elapsed() - tick_start);
+			recorder->record(record);
 		}
 
-		// Get output of PID controllers and cap to max power
-		double dt = SAMPLE_RATE / 1000.0;
-		double drive_power = math::clamp(drive_controller.update(drive_error, dt), -max_drive_power, max_drive_power);
-		double turn_power = math::clamp(turn_controller.update(turn_error, dt), -max_turn_power, max_turn_power);
+		TAO_PROFILE_RECORD(timing(TimingStage::Tick), static_cast<uint32_t>(tracking_timer.elapsed() - tick_start));
 
-		// Scale drive power by the cosine of turn_error if moving to a point.
-		// This biases turn power over drive power at the start of the movement, which makes the
-		// arc shapes less dramatic when moving to a point.
-		if (target_type == TargetType::Point) {
-			drive_power *= std::cos(math::to_radians(turn_error));
+		mutex.unlock();
+		TAO_TRACE_END("tick");
+
+		previous_tick_start = tick_start;
+		scheduler.wait();
+	}
+
+	// Stop the motors before the thread joins to prevent them from running at whatever the last voltage command was.
+	env::motor_group_set_voltage(left_motors, 0.0);
+	env::motor_group_set_voltage(right_motors, 0.0);
+
+	TAO_LOG_INFO(logger, "Tracking period stopped.");
+
+	return 0;
+}
+
+void DifferentialDrivetrain::add_tracking_stages(RateScheduler& scheduler) {
+	// Each stage of the control chain runs at its own rate. Stages that are due on the same tick
+	// run in the order they are added here, so measurements are always taken before the controllers
+	// that use them, and the controllers always update before their output is applied. Each stage is timed
+	// individually, so time spent reading sensors can be told apart from the math and logging.
+	scheduler.add_stage(SENSOR_PERIOD, [this](double dt) { TAO_PROFILE_SCOPE(timing(TimingStage::Sensors)); update_sensors(dt); });
+	scheduler.add_stage(ODOMETRY_PERIOD, [this](double dt) { TAO_PROFILE_SCOPE(timing(TimingStage::Odometry)); update_odometry(dt); });
+	scheduler.add_stage(PATH_PERIOD, [this](double dt) { TAO_PROFILE_SCOPE(timing(TimingStage::Path)); update_path(dt); });
+	scheduler.add_stage(CONTROL_PERIOD, [this](double dt) { TAO_PROFILE_SCOPE(timing(TimingStage::Control)); update_control(dt); });
+	scheduler.add_stage(VELOCITY_PERIOD, [this](double dt) { TAO_PROFILE_SCOPE(timing(TimingStage::Velocity)); update_velocity(dt); });
+	scheduler.add_stage(OUTPUT_PERIOD, [this](double dt) { TAO_PROFILE_SCOPE(timing(TimingStage::Output)); update_output(dt); });
+	scheduler.add_stage(SETTLE_PERIOD, [this](double dt) { TAO_PROFILE_SCOPE(timing(TimingStage::Settle)); update_settle(dt); });
+	scheduler.add_stage(FAULT_PERIOD, [this](double dt) { TAO_PROFILE_SCOPE(timing(TimingStage::Faults)); update_faults(dt); });
+	scheduler.add_stage(DIAGNOSTICS_PERIOD, [this](double dt) { TAO_PROFILE_SCOPE(timing(TimingStage::Diagnostics)); update_diagnostics(dt); });
+	scheduler.add_stage(TELEMETRY_PERIOD, [this](double dt) { TAO_PROFILE_SCOPE(timing(TimingStage::Telemetry)); update_telemetry(dt); });
+	scheduler.add_stage(STATUS_PERIOD, [this](double dt) { TAO_PROFILE_SCOPE(timing(TimingStage::Status)); update_status(dt); });
+}
+
+void DifferentialDrivetrain::update_sensors(double dt) {
+	// Replayed ticks are given their sensor readings rather than reading them from devices.
+	if (replaying) return;
+
+	std::pair<double, double> wheel_travel = get_wheel_travel();
+	std::pair<double, double> wheel_velocities = get_wheel_velocities();
+
+	sensors.timestamp = static_cast<uint32_t>(tracking_timer.elapsed());
+	sensors.left_travel = wheel_travel.first;
+	sensors.right_travel = wheel_travel.second;
+	sensors.left_velocity = wheel_velocities.first;
+	sensors.right_velocity = wheel_velocities.second;
+
+	if (imu != nullptr) {
+		Vector2 acceleration = env::imu_get_acceleration(*imu);
+
+		sensors.imu_installed = env::imu_is_installed(*imu);
+		sensors.imu_calibrating = env::imu_is_calibrating(*imu);
+		sensors.imu_heading = env::imu_get_heading(*imu);
+		sensors.imu_acceleration_x = acceleration.get_x();
+		sensors.imu_acceleration_y = acceleration.get_y();
+	} else {
+		sensors.imu_installed = false;
+		sensors.imu_calibrating = false;
+		sensors.imu_heading = 0.0;
+		sensors.imu_acceleration_x = 0.0;
+		sensors.imu_acceleration_y = 0.0;
+	}
+}
+
+void DifferentialDrivetrain::update_odometry(double dt) {
+	// The imu has was passed in, but is not plugged in. Invalidate it's readings for the duration of the tracking routine.
+	if (!imu_invalid && imu != nullptr && !sensors.imu_installed) {
+		imu_invalid = true;
+		TAO_LOG_ERROR(logger, "IMU was unplugged. Switching to wheeled heading calculation (less accurate).");
+	}
+
+	double wheel_heading = calculate_wheel_heading(sensors.left_travel, sensors.right_travel);
+
+	// If the imu finished calibrating after the tracking period started, switch over to it. The imu's
+	// readings are offset to continue from the current wheel heading, so the heading doesn't jump.
+	if (!imu_active && imu != nullptr && !imu_invalid && !imu_calibrating && !sensors.imu_calibrating) {
+		imu_heading_offset = wheel_heading + sensors.imu_heading;
+		imu_active = true;
+
+		TAO_LOG_INFO(logger, "IMU calibration finished. Switching to imu heading.");
+	}
+
+	// Measure the current absolute heading and calculate the change in heading from the last loop sample
+	if (imu_active && !imu_invalid) {
+		heading = std::fmod((360.0 - sensors.imu_heading) + imu_heading_offset, 360.0);
+	} else {
+		heading = wheel_heading;
+	}
+	double delta_heading = heading - previous_heading;
+	previous_heading = heading;
+
+	// Measure the forward travel by taking the average value of all encoders.
+	forward_travel = (sensors.left_travel + sensors.right_travel) / 2;
+	double delta_forward_travel = forward_travel - previous_forward_travel;
+	previous_forward_travel = forward_travel;
+
+	// assume no sideways travel for now.
+	constexpr double delta_sideways_travel = 0.0;
+
+	// Find the average between the current and previous headings
+	// This is useful to know when performing odometry calculations, since
+	// it provides a more accurate estimation of the robot's heading
+	// "during the movement". Simply rotating by the current heading after
+	// the movement would build up error faster.
+	double average_heading = previous_heading + delta_heading / 2.0;
+
+	// Both estimates rotate by the average heading, so its sine and cosine are only calculated once.
+	math::SinCos<double> average_rotation = math::sincos(math::to_radians(average_heading));
+
+	// Estimate change in global position
+	if (delta_heading == 0.0) {
+		// Fallback estimation to avoid divide-by-zero errors
+		position += Vector2(delta_forward_travel, delta_sideways_travel).rotated(average_rotation.sin, average_rotation.cos);
+	} else {
+		// Using chord length formula
+		double delta_radians = math::to_radians(delta_heading);
+		double chord_scale = 2.0 * math::fast_sin(delta_radians / 2.0) / delta_radians;
+
+		position += Vector2(
+			delta_forward_travel * chord_scale,
+			0.0 // delta_sideways_travel * chord_scale
+		).rotated(average_rotation.sin, average_rotation.cos);
+	}
+}
+
+void DifferentialDrivetrain::update_path(double dt) {
+	// Replayed ticks aim for the lookahead point that was recorded, since the path isn't part of the recording.
+	if (replaying) {
+		if (path_target_set) set_target(path_target);
+		return;
+	}
+
+	if (!following_path) return;
+
+	// Stop following the path if the movement was aborted by a stall or collision, or replaced by another movement.
+	if (move_status != MoveStatus::Moving || move_id != path_move_id) {
+		following_path = false;
+		return;
+	}
+
+	// Move on to the next segment of the path once the end of the current one is within the lookahead distance.
+	while (path_index + 1 < path.size() && position.distance_squared(path[path_index + 1]) <= lookahead_distance * lookahead_distance) {
+		path_index++;
+	}
+
+	// Once the end of the path is within reach, the movement settles on the last lookahead point.
+	if (path_index + 1 >= path.size()) {
+		following_path = false;
+		return;
+	}
+
+	Vector2 start = path[path_index]; // The current waypoint
+	Vector2 end = path[path_index + 1]; // The next waypoint
+
+	// Find the point(s) of intersection between a circle centered around our global position with the radius of our
+	// lookahead distance and a line segment formed between our starting/ending points.
+	geometry::Intersections<2> intersections = geometry::segment_circle_intersections(start, end, position, lookahead_distance);
+
+	// Intersections are ordered along the segment, so the last one is closest to the end of the segment. Going to it
+	// ensures that we don't go backwards along the path.
+	if (intersections.count > 0) {
+		path_target = intersections.points[intersections.count - 1];
+		path_target_set = true;
+		set_target(path_target);
+	}
+}
+
+void DifferentialDrivetrain::update_control(double dt) {
+	// Recalculate error for each PID controller.
+	// - If in absolute mode, the error is determined by the robot's distance from a point (the target is an absolute Vector2).
+	// - If in relative mode, the error is determined by a target encoder distance and heading (The target is heading and distance).
+	if (target_type == TargetType::Point) {
+		Vector2 local_target = target_position - position;
+
+		turn_error = math::normalize_degrees(heading - math::to_degrees(math::fast_atan2(local_target.get_y(), local_target.get_x())));
+		drive_error = local_target.get_magnitude();
+
+		// If the turn error exceeds 90 degrees, then the point is behind the
+		// robot, so it's more efficient to travel to the point backwards.
+		if (std::abs(turn_error) >= 90.0) {
+			turn_error = math::normalize_degrees(turn_error - 180.0);
+			drive_error *= -1.0;
 		}
+	} else if (target_type == TargetType::DistanceAndHeading) {
+		turn_error = math::normalize_degrees(heading - target_heading);
+		drive_error = target_distance - forward_travel;
+	}
+
+	// Get output of PID controllers and cap to max power
+	drive_power = math::clamp(drive_controller.update(drive_error, dt), -max_drive_power, max_drive_power);
+	turn_power = math::clamp(turn_controller.update(turn_error, dt), -max_turn_power, max_turn_power);
 
+	// Scale drive power by the cosine of turn_error if moving to a point.
+	// This biases turn power over drive power at the start of the movement, which makes the
+	// arc shapes less dramatic when moving to a point.
+	if (target_type == TargetType::Point) {
+		drive_power *= math::fast_cos(math::to_radians(turn_error));
+	}
+
+	if (max_velocity > 0.0) {
+		// Convert drive and turn power to left and right velocity setpoints, which will be
+		// tracked by the inner velocity loop.
+		std::pair<double, double> normalized_setpoints = math::normalize_speeds(
+			max_velocity * (drive_power + turn_power) / 100,
+			max_velocity * (drive_power - turn_power) / 100,
+			max_velocity
+		);
+
+		// The change in setpoint since the last update is used as the desired acceleration by the feedforward model.
+		left_acceleration_setpoint = (normalized_setpoints.first - left_velocity_setpoint) / dt;
+		right_acceleration_setpoint = (normalized_setpoints.second - right_velocity_setpoint) / dt;
+
+		left_velocity_setpoint = normalized_setpoints.first;
+		right_velocity_setpoint = normalized_setpoints.second;
+	} else {
 		// Convert drive and turn power to left and right motor voltages
 		std::pair<double, double> normalized_voltages = math::normalize_speeds(
 			12.0 * (drive_power + turn_power) / 100,
@@ -359,86 +749,654 @@ int DifferentialDrivetrain::tracking() {
 			12.0
 		);
 
-		// Spin motors at the output voltage.
-		env::motor_group_set_voltage(left_motors, normalized_voltages.first);
-		env::motor_group_set_voltage(right_motors, normalized_voltages.second);
+		left_voltage = normalized_voltages.first;
+		right_voltage = normalized_voltages.second;
+	}
+}
 
-		// Check if the errors of both loops are under their tolerances.
-		// If they are, increment the settle_counter. If they aren't, reset the counter.
-		if ((std::abs(drive_error) <= drive_tolerance) && ((std::abs(turn_error) <= turn_tolerance) || target_type == TargetType::Point)) {
-			settle_counter++;
-		} else {
-			settle_counter = 0;
+void DifferentialDrivetrain::update_velocity(double dt) {
+	if (max_velocity <= 0.0) return;
+
+	// Measure the velocity of each side and correct the difference from its setpoint.
+	// The voltage estimated by each side's feedforward model is applied directly, leaving the
+	// PID controllers to make up for any load or battery variation. If the drivetrain hasn't been
+	// characterized, voltage is assumed to scale linearly with velocity up to max_velocity.
+
+	double left_feedforward_voltage = left_feedforward.is_configured()
+		? left_feedforward.calculate(left_velocity_setpoint, left_acceleration_setpoint)
+		: 12.0 * left_velocity_setpoint / max_velocity;
+	double right_feedforward_voltage = right_feedforward.is_configured()
+		? right_feedforward.calculate(right_velocity_setpoint, right_acceleration_setpoint)
+		: 12.0 * right_velocity_setpoint / max_velocity;
+
+	left_voltage = math::clamp(
+		left_feedforward_voltage + left_velocity_controller.update(left_velocity_setpoint - sensors.left_velocity, dt),
+		-12.0, 12.0
+	);
+	right_voltage = math::clamp(
+		right_feedforward_voltage + right_velocity_controller.update(right_velocity_setpoint - sensors.right_velocity, dt),
+		-12.0, 12.0
+	);
+}
+
+void DifferentialDrivetrain::update_output(double dt) {
+	if (aborted) {
+		// Ramp the output down to zero rather than cutting it, which would lurch the robot or tip it
+		// if it was stopped by a collision.
+		double step = ABORT_RAMP_RATE * dt;
+		left_output_voltage -= math::clamp(left_output_voltage, -step, step);
+		right_output_voltage -= math::clamp(right_output_voltage, -step, step);
+	} else {
+		left_output_voltage = left_voltage;
+		right_output_voltage = right_voltage;
+	}
+
+	if (move_status == MoveStatus::Moving) {
+		current_move.peak_voltage = std::max(current_move.peak_voltage, std::max(std::abs(left_output_voltage), std::abs(right_output_voltage)));
+	}
+
+	// Spin motors at the output voltage.
+	if (!replaying) {
+		env::motor_group_set_voltage(left_motors, left_output_voltage);
+		env::motor_group_set_voltage(right_motors, right_output_voltage);
+	}
+}
+
+void DifferentialDrivetrain::update_settle(double dt) {
+	// Check if the errors of both loops are under their tolerances.
+	// If they are, increment the settle_counter. If they aren't, reset the counter.
+	if ((std::abs(drive_error) <= drive_tolerance) && ((std::abs(turn_error) <= turn_tolerance) || target_type == TargetType::Point)) {
+		settle_counter++;
+	} else {
+		settle_counter = 0;
+	}
+
+	if (move_status == MoveStatus::Moving) {
+		// Errors are measured for the first time on the first update after the movement starts. The drivetrain has
+		// overshot once an error crosses over to the opposite sign.
+		if (!move_errors_measured) {
+			initial_drive_error_sign = math::sign(drive_error);
+			initial_turn_error_sign = math::sign(turn_error);
+			move_errors_measured = true;
+		}
+
+		current_move.drive_overshoot = std::max(current_move.drive_overshoot, -initial_drive_error_sign * drive_error);
+		current_move.turn_overshoot = std::max(current_move.turn_overshoot, -initial_turn_error_sign * turn_error);
+
+		if (settle_counter > 0 && current_move.reach_time == 0) {
+			current_move.reach_time = static_cast<uint32_t>(tracking_timer.elapsed()) - current_move.start_time;
 		}
+	}
 
-		// Once the settle_counter reaches 5 (~50ms of wait time), the drivetrain is now considered "settled", and
-		// blocking movement functions will now complete.
-		if (settle_counter >= 5 && !settled) {
-			logger.debug("DifferentialDrivetrain has settled. Drive error: %f, Turn error: %f", drive_error, turn_error);
+	// Once the errors have been within tolerance for SETTLE_TIME (~50ms), the drivetrain is now considered "settled", and
+	// blocking movement functions will now complete.
+	if (settle_counter >= static_cast<int32_t>(SETTLE_TIME / SETTLE_PERIOD) && !settled) {
+		TAO_LOG_DEBUG(logger, "DifferentialDrivetrain has settled. Drive error: %f, Turn error: %f", drive_error, turn_error);
 
-			if (target_type == TargetType::Point) {
-				set_target(forward_travel, heading);
+		if (target_type == TargetType::Point) {
+			set_target(forward_travel, heading);
+		}
+
+		end_move(MoveStatus::Settled);
+
+		settled = true;
+		move_status = MoveStatus::Settled;
+		settle_counter = 0;
+	}
+}
+
+void DifferentialDrivetrain::update_faults(double dt) {
+	// Faults only end movements that are in progress.
+	if (settled) return;
+
+	// A stall is detected when either side of the drivetrain is being driven with a significant voltage,
+	// but isn't moving. If this persists for stall_time, then the movement is aborted. No velocity is below a
+	// stall_velocity of 0, so detection needs both to be set.
+	if (stall_time > 0 && stall_velocity > 0.0) {
+		bool left_stalled = std::abs(left_output_voltage) >= STALL_VOLTAGE && std::abs(sensors.left_velocity) < stall_velocity;
+		bool right_stalled = std::abs(right_output_voltage) >= STALL_VOLTAGE && std::abs(sensors.right_velocity) < stall_velocity;
+
+		if (left_stalled || right_stalled) {
+			stall_timer += static_cast<uint32_t>(dt * 1000.0 + 0.5);
+		} else {
+			stall_timer = 0;
+		}
+
+		if (stall_timer >= stall_time) {
+			// Current draw isn't recorded, so replayed stalls are reported without it.
+			if (replaying) {
+				TAO_LOG_WARNING(logger, "Movement aborted: drivetrain stalled. Drive error: %f, Turn error: %f", drive_error, turn_error);
+			} else {
+				TAO_LOG_WARNING(logger, "Movement aborted: drivetrain stalled. Drive error: %f, Turn error: %f, Current: %fA (left) %fA (right)",
+					drive_error, turn_error,
+					env::motor_group_get_current(left_motors), env::motor_group_get_current(right_motors));
 			}
 
-			settled = true;
-			settle_counter = 0;
+			abort_move(MoveStatus::Stalled);
+			return;
+		}
+	}
+
+	// A collision is detected as a spike in planar acceleration measured by the imu.
+	if (collision_acceleration > 0.0 && imu_active && !imu_invalid) {
+		double acceleration = Vector2(sensors.imu_acceleration_x, sensors.imu_acceleration_y).get_magnitude();
+
+		if (acceleration >= collision_acceleration) {
+			TAO_LOG_WARNING(logger, "Movement aborted: collision detected (%fg). Drive error: %f, Turn error: %f",
+				acceleration, drive_error, turn_error);
+
+			abort_move(MoveStatus::Collided);
+		}
+	}
+}
+
+void DifferentialDrivetrain::update_diagnostics(double dt) {
+	// Motor temperatures aren't recorded, and don't affect the tick, so they aren't checked while replaying.
+	if (replaying) return;
+
+	// Report when the drivetrain motors get hot enough to start limiting their output.
+	double temperature = std::max(
+		env::motor_group_get_temperature(left_motors),
+		env::motor_group_get_temperature(right_motors)
+	);
+
+	if (temperature >= TEMPERATURE_WARNING && !temperature_warned) {
+		TAO_LOG_WARNING(logger, "Drivetrain motors are overheating (%fC). Output may be limited.", temperature);
+		temperature_warned = true;
+	} else if (temperature < TEMPERATURE_WARNING) {
+		temperature_warned = false;
+	}
+}
+
+void DifferentialDrivetrain::update_telemetry(double dt) {
+	telemetry_publisher.tick(static_cast<uint32_t>(dt * 1000.0 + 0.5));
+
+	// Data is only gathered for channels that are due and have subscribers.
+	uint32_t timestamp = static_cast<uint32_t>(tracking_timer.elapsed());
+
+	if (telemetry_publisher.is_due(telemetry::Channel::Pose)) {
+		telemetry_publisher.publish(telemetry::Pose { timestamp, position.get_x(), position.get_y(), heading });
+	}
+
+	if (telemetry_publisher.is_due(telemetry::Channel::State)) {
+		PIDController::Terms drive_terms = drive_controller.get_terms();
+		PIDController::Terms turn_terms = turn_controller.get_terms();
+
+		telemetry::Sample sample;
+		sample.timestamp = timestamp;
+		sample.x = position.get_x();
+		sample.y = position.get_y();
+		sample.heading = heading;
+		sample.drive_error = drive_error;
+		sample.turn_error = turn_error;
+		sample.drive_p = drive_terms.proportional;
+		sample.drive_i = drive_terms.integral;
+		sample.drive_d = drive_terms.derivative;
+		sample.turn_p = turn_terms.proportional;
+		sample.turn_i = turn_terms.integral;
+		sample.turn_d = turn_terms.derivative;
+		sample.left_voltage = left_output_voltage;
+		sample.right_voltage = right_output_voltage;
+
+		telemetry_publisher.publish(sample);
+	}
+
+	if (telemetry_publisher.is_due(telemetry::Channel::Gains)) {
+		telemetry_publisher.publish(telemetry::Gains {
+			timestamp,
+			drive_controller.get_gains(),
+			turn_controller.get_gains(),
+			left_velocity_controller.get_gains()
+		});
+	}
+}
+
+void DifferentialDrivetrain::update_status(double dt) {
+	// Heading is taken from the last odometry update rather than measured again.
+	TAO_LOG_INFO(logger, "Position: (%f, %f) Heading: %f\u00B0", position.get_x(), position.get_y(), heading);
+}
+
+void DifferentialDrivetrain::record_inputs(FlightRecorder::Record& record, uint64_t tick) const {
+	record.tick = static_cast<uint32_t>(tick);
+	record.target_type = target_type == TargetType::Point ? 1 : 0;
+	record.target_x = target_position.get_x();
+	record.target_y = target_position.get_y();
+	record.target_distance = target_distance;
+	record.target_heading = target_heading;
+	record.max_drive_power = max_drive_power;
+	record.max_turn_power = max_turn_power;
+	record.move_status = static_cast<uint8_t>(move_status);
+}
+
+void DifferentialDrivetrain::record_outputs(FlightRecorder::Record& record) const {
+	record.sensors = sensors;
+	record.path_target_set = path_target_set ? 1 : 0;
+	record.path_target_x = path_target.get_x();
+	record.path_target_y = path_target.get_y();
+	record.x = position.get_x();
+	record.y = position.get_y();
+	record.heading = heading;
+	record.drive_error = drive_error;
+	record.turn_error = turn_error;
+	record.drive_power = drive_power;
+	record.turn_power = turn_power;
+	record.left_velocity_setpoint = left_velocity_setpoint;
+	record.right_velocity_setpoint = right_velocity_setpoint;
+	record.left_voltage = left_output_voltage;
+	record.right_voltage = right_output_voltage;
+	record.drive_integral = drive_controller.get_integral();
+	record.turn_integral = turn_controller.get_integral();
+	record.left_velocity_integral = left_velocity_controller.get_integral();
+	record.right_velocity_integral = right_velocity_controller.get_integral();
+}
+
+void DifferentialDrivetrain::FrameSink::on_state(const telemetry::Sample& sample) {
+	if (!logger.is_enabled(Logger::Level::TELEMETRY)) return;
+
+	// Frames are written through the logger so that they can't be split by text messages on the same stream.
+	uint8_t frame[telemetry::MAX_FRAME_SIZE];
+	std::size_t size = encoder.encode(sample, frame, sizeof(frame));
+	logger.write(frame, size);
+}
+
+// Lifecycle
+
+void DifferentialDrivetrain::calibrate_imu(bool blocking) {
+	if (imu == nullptr) return;
+
+	lock_mutex();
+	bool already_calibrating = imu_calibrating;
+	if (!already_calibrating) {
+		imu_calibrating = true;
+		imu_calibrated = false;
+	}
+	mutex.unlock();
+
+	if (!already_calibrating) {
+		// Join a previous (finished) calibration thread before starting a new one.
+		if (calibration_thread != nullptr) {
+			calibration_thread->join();
 		}
 
+		calibration_thread = std::make_shared<env::Thread>(threading::make_member_thread(this, &DifferentialDrivetrain::imu_calibration));
+	}
+
+	if (blocking) wait_until_imu_calibrated();
+}
+
+int DifferentialDrivetrain::imu_calibration() {
+	TAO_TRACE_THREAD_NAME("imu calibration");
+	TAO_TRACE_SCOPE("calibrate imu");
+
+	if (!env::imu_is_installed(*imu)) {
+		TAO_LOG_ERROR(logger, "IMU not plugged in. Skipping calibration.");
+
+		lock_mutex();
+		imu_calibrating = false;
 		mutex.unlock();
-		env::sleep_for(SAMPLE_RATE);
+
+		return 0;
 	}
 
-	// Stop the motors before the thread joins to prevent them from running at whatever the last voltage command was.
-	env::motor_group_set_voltage(left_motors, 0.0);
-	env::motor_group_set_voltage(right_motors, 0.0);
+	// Prevent a possible race condition that can occur if the imu isn't detected as plugged in yet.
+	env::sleep_for(250);
+	env::imu_calibrate(*imu);
+	env::sleep_for(100);
+	while (env::imu_is_calibrating(*imu)) { env::sleep_for(10); }
+	env::sleep_for(250);
+
+	lock_mutex();
+	imu_calibrating = false;
+	imu_calibrated = true;
+	mutex.unlock();
 
-	logger.info("Tracking period stopped.");
+	TAO_LOG_DEBUG(logger, "IMU calibration finished.");
 
 	return 0;
 }
 
-int DifferentialDrivetrain::logging() {
-	int64_t time = 0;
-
-	// Log data periodically
-	while (logging_active) {
-		mutex.lock();
-		Vector2 position_ = position;
+void DifferentialDrivetrain::wait_until_imu_calibrated() {
+	while (true) {
+		lock_mutex();
+		bool calibrating = imu_calibrating;
 		mutex.unlock();
-		
-		// logger.telemetry("{type:\"TELEMETRY_UPDATE\",data:{position: {x: %f,y: %f},heading: %f,pid: {drive: {kP: %f,kI: %f,kD: %f,},turn: {kP: %f,kI: %f,kD: %f,}}}}");
 
-		// This is a gross way to do this, but I sure as hell don't feel like
-		// starting more threads right now.
-		if (time % 1000 == 0) {
-			logger.info("Position: (%f, %f) Heading: %f\u00B0", position_.get_x(), position_.get_y(), get_heading());
+		if (!calibrating) break;
+		env::sleep_for(10);
+	}
+}
+
+DifferentialDrivetrain::Config DifferentialDrivetrain::characterize(double ramp_rate, double step_voltage, double duration) {
+	Config config = get_config();
+
+	if (tracking_active) {
+		TAO_LOG_ERROR(logger, "Cannot characterize the drivetrain while tracking is active. Call drivetrain.stop_tracking() first.");
+		return config;
+	}
+
+	TAO_LOG_INFO(logger, "Characterizing drivetrain. The robot will drive forwards, backwards, then spin in place.");
+
+	// Wheel travel is measured with the latest wheel diameter and gearing, since the tracking loop isn't around to pick them up.
+	lock_mutex();
+	apply_config();
+	mutex.unlock();
+
+	// Fit feedforward constants for each side using a quasistatic ramp (where acceleration is negligible, isolating kS and kV)
+	// and a dynamic step (where acceleration dominates, isolating kA) in both directions.
+	Feedforward::Regression left_regression, right_regression;
+
+	run_characterization_test(1.0, ramp_rate, 0.0, duration, left_regression, right_regression);
+	run_characterization_test(-1.0, ramp_rate, 0.0, duration, left_regression, right_regression);
+	run_characterization_test(1.0, 0.0, step_voltage, duration, left_regression, right_regression);
+	run_characterization_test(-1.0, 0.0, step_voltage, duration, left_regression, right_regression);
+
+	config.left_feedforward = left_regression.solve();
+	config.right_feedforward = right_regression.solve();
+
+	if (config.left_feedforward.kV > 0.0 && config.right_feedforward.kV > 0.0) {
+		// The fastest velocity that both sides can hold at 12 volts.
+		config.max_velocity = std::min(
+			(12.0 - config.left_feedforward.kS) / config.left_feedforward.kV,
+			(12.0 - config.right_feedforward.kS) / config.right_feedforward.kV
+		);
+	} else {
+		TAO_LOG_WARNING(logger, "Feedforward characterization failed. The drivetrain didn't move enough to fit a model.");
+	}
+
+	TAO_LOG_INFO(logger, "Left feedforward: kS = %f, kV = %f, kA = %f (%d samples)",
+		config.left_feedforward.kS, config.left_feedforward.kV, config.left_feedforward.kA, left_regression.get_sample_count());
+	TAO_LOG_INFO(logger, "Right feedforward: kS = %f, kV = %f, kA = %f (%d samples)",
+		config.right_feedforward.kS, config.right_feedforward.kV, config.right_feedforward.kA, right_regression.get_sample_count());
+
+	// Spin in place and compare the rotation measured by the imu with the difference in wheel travel. Since the
+	// wheels travel along an arc of radius (track_width / 2), track_width = (right_travel - left_travel) / rotation.
+	if (imu != nullptr && env::imu_is_installed(*imu)) {
+		std::pair<double, double> start_travel = get_wheel_travel();
+		double start_rotation = env::imu_get_rotation(*imu);
+
+		for (int32_t time = 0; time < duration * 1000; time += 10) {
+			env::motor_group_set_voltage(left_motors, -step_voltage / 2.0);
+			env::motor_group_set_voltage(right_motors, step_voltage / 2.0);
+			env::sleep_for(10);
 		}
 
-		env::sleep_for(10);
-		time += 10;
+		env::motor_group_set_voltage(left_motors, 0.0);
+		env::motor_group_set_voltage(right_motors, 0.0);
+		env::sleep_for(1000);
+
+		std::pair<double, double> end_travel = get_wheel_travel();
+
+		// The imu reports clockwise rotation, so it is negated to get counterclockwise rotation.
+		double rotation = math::to_radians(start_rotation - env::imu_get_rotation(*imu));
+		double travel = (end_travel.second - start_travel.second) - (end_travel.first - start_travel.first);
+
+		if (std::abs(rotation) > 0.0) {
+			config.track_width = travel / rotation;
+			TAO_LOG_INFO(logger, "Effective track width: %f", config.track_width);
+		}
+	} else {
+		TAO_LOG_WARNING(logger, "No imu available. Skipping track width measurement.");
 	}
 
-	return 0;
+	return config;
 }
 
-// Lifecycle
+void DifferentialDrivetrain::run_characterization_test(double direction, double ramp_rate, double step_voltage, double duration,
+	Feedforward::Regression& left_regression, Feedforward::Regression& right_regression) {
+	constexpr int32_t SAMPLE_RATE = 10;
+	constexpr double dt = SAMPLE_RATE / 1000.0;
 
-void DifferentialDrivetrain::calibrate_imu() {
-	if (imu != nullptr) {
-		if (!env::imu_is_installed(*imu)) {
-			logger.error("IMU not plugged in. Skipping calibration.");
-			return;
+	std::pair<double, double> previous_velocities = get_wheel_velocities();
+
+	for (int32_t time = 0; time < duration * 1000; time += SAMPLE_RATE) {
+		double voltage = direction * math::clamp(step_voltage + ramp_rate * (time / 1000.0), 0.0, 12.0);
+
+		env::motor_group_set_voltage(left_motors, voltage);
+		env::motor_group_set_voltage(right_motors, voltage);
+		env::sleep_for(SAMPLE_RATE);
+
+		std::pair<double, double> velocities = get_wheel_velocities();
+
+		// Samples taken before a side has broken away from static friction carry no information about the model.
+		if (velocities.first != 0.0) {
+			left_regression.add_sample(voltage, velocities.first, (velocities.first - previous_velocities.first) / dt);
+		}
+		if (velocities.second != 0.0) {
+			right_regression.add_sample(voltage, velocities.second, (velocities.second - previous_velocities.second) / dt);
 		}
-		
-		// Prevent a possible race condition that can occur if the imu isn't detected as plugged in yet.
-		env::sleep_for(250);
-		env::imu_calibrate(*imu);
-		env::sleep_for(100);
-		while (env::imu_is_calibrating(*imu)) { env::sleep_for(10); }
-		env::sleep_for(250);
 
-		imu_calibrated = true;
+		previous_velocities = velocities;
+	}
+
+	// Let the drivetrain come to a complete stop before the next test.
+	env::motor_group_set_voltage(left_motors, 0.0);
+	env::motor_group_set_voltage(right_motors, 0.0);
+	env::sleep_for(1000);
+}
+
+// Flight recorder
+
+void DifferentialDrivetrain::start_recording(std::size_t capacity, const std::string& dump_path) {
+	// The recorder is allocated here rather than in the loop, so recording never allocates.
+	std::shared_ptr<FlightRecorder> new_recorder = std::make_shared<FlightRecorder>(capacity);
+
+	lock_mutex();
+	recorder = std::move(new_recorder);
+	recording_path = dump_path;
+	recording_dump_pending = false;
+	mutex.unlock();
+}
+
+void DifferentialDrivetrain::stop_recording() {
+	// The recorder is released outside of the mutex, since freeing it can take a moment. A dump in progress
+	// on another thread keeps its own reference, so it can finish safely.
+	lock_mutex();
+	std::shared_ptr<FlightRecorder> old_recorder = std::move(recorder);
+	recording_path.clear();
+	recording_dump_pending = false;
+	mutex.unlock();
+}
+
+bool DifferentialDrivetrain::dump_recording(const std::string& path) {
+	// Take a snapshot while holding the mutex, so the tracking thread can't be partway through recording a tick.
+	// The file itself is written without the mutex, so the loop keeps running (and recording) while the SD card is slow.
+	lock_mutex();
+	std::shared_ptr<FlightRecorder> dump_recorder = recorder;
+	FlightRecorder::Snapshot snapshot = {};
+	if (dump_recorder != nullptr) snapshot = dump_recorder->snapshot();
+	mutex.unlock();
+
+	if (dump_recorder == nullptr) return false;
+
+	// The config is written at the top of the file, so that recordings can be replayed with the same tuning.
+	Config config = get_config();
+	char preamble[1024];
+	snprintf(preamble, sizeof(preamble),
+		"# config drive_gains=%.17g,%.17g,%.17g,%.17g turn_gains=%.17g,%.17g,%.17g,%.17g "
+		"drive_tolerance=%.17g turn_tolerance=%.17g lookahead_distance=%.17g track_width=%.17g "
+		"wheel_diameter=%.17g gearing=%.17g velocity_gains=%.17g,%.17g,%.17g,%.17g max_velocity=%.17g "
+		"left_feedforward=%.17g,%.17g,%.17g right_feedforward=%.17g,%.17g,%.17g "
+		"stall_time=%u stall_velocity=%.17g collision_acceleration=%.17g\n",
+		config.drive_gains.kP, config.drive_gains.kI, config.drive_gains.kD, config.drive_gains.i_threshold,
+		config.turn_gains.kP, config.turn_gains.kI, config.turn_gains.kD, config.turn_gains.i_threshold,
+		config.drive_tolerance, config.turn_tolerance, config.lookahead_distance, config.track_width,
+		config.wheel_diameter, config.gearing,
+		config.velocity_gains.kP, config.velocity_gains.kI, config.velocity_gains.kD, config.velocity_gains.i_threshold,
+		config.max_velocity,
+		config.left_feedforward.kS, config.left_feedforward.kV, config.left_feedforward.kA,
+		config.right_feedforward.kS, config.right_feedforward.kV, config.right_feedforward.kA,
+		static_cast<unsigned int>(config.stall_time), config.stall_velocity, config.collision_acceleration);
+
+	std::size_t dumped = 0;
+	bool success = dump_recorder->dump(path.c_str(), snapshot, preamble, &dumped);
+
+	if (success && dumped < snapshot.count) {
+		TAO_LOG_WARNING(logger, "Flight recording written to %s, but %u of %u ticks were overwritten before they could be written.",
+			path.c_str(), static_cast<unsigned int>(snapshot.count - dumped), static_cast<unsigned int>(snapshot.count));
+	} else if (success) {
+		TAO_LOG_INFO(logger, "Flight recording (%u ticks) written to %s.", static_cast<unsigned int>(dumped), path.c_str());
+	} else {
+		TAO_LOG_ERROR(logger, "Could not write flight recording to %s. Is an SD card inserted?", path.c_str());
 	}
+
+	return success;
+}
+
+void DifferentialDrivetrain::dump_pending_recording() {
+	lock_mutex();
+	bool pending = recording_dump_pending;
+	std::string path = recording_path;
+	recording_dump_pending = false;
+	mutex.unlock();
+
+	if (pending) dump_recording(path);
+}
+
+// Replay
+
+bool DifferentialDrivetrain::begin_replay(const FlightRecorder::Record& record) {
+	if (tracking_active) {
+		TAO_LOG_ERROR(logger, "Cannot replay a recording while tracking is active. Call drivetrain.stop_tracking() first.");
+		return false;
+	}
+
+	lock_mutex();
+	apply_config();
+
+	// Odometry only keeps the travel and heading from the last tick that it ran on, so the replay has to start from one of those ticks.
+	replay_scheduler = std::make_shared<RateScheduler>();
+	add_tracking_stages(*replay_scheduler);
+
+	if (!replay_scheduler->is_due(ODOMETRY_PERIOD, record.tick) || !replay_scheduler->is_due(CONTROL_PERIOD, record.tick)) {
+		replay_scheduler = nullptr;
+		replaying = false;
+		mutex.unlock();
+		return false;
+	}
+
+	// Restore the state that the recorded tick left the drivetrain in.
+	sensors = record.sensors;
+	position = Vector2(record.x, record.y);
+	heading = previous_heading = record.heading;
+	forward_travel = previous_forward_travel = (record.sensors.left_travel + record.sensors.right_travel) / 2;
+
+	// Both wheel and imu heading are offset so that they continue from the recorded heading.
+	start_heading = record.heading - math::to_degrees((record.sensors.right_travel - record.sensors.left_travel) / track_width);
+	imu_invalid = false;
+	imu_calibrating = false;
+	imu_active = imu != nullptr && record.sensors.imu_installed && !record.sensors.imu_calibrating;
+	imu_heading_offset = record.heading + record.sensors.imu_heading;
+
+	apply_recorded_commands(record);
+
+	// A replay started again after a gap may still be in a movement that the recording had already ended.
+	MoveStatus recorded_status = static_cast<MoveStatus>(record.move_status);
+	if (recorded_status != MoveStatus::Moving) {
+		end_move(recorded_status);
+		move_status = recorded_status;
+	}
+
+	// The path stage only aims for recorded lookahead points while replaying, so the path (if any) is dropped.
+	path.clear();
+	following_path = false;
+	path_target_set = false;
+
+	drive_error = record.drive_error;
+	turn_error = record.turn_error;
+	drive_power = record.drive_power;
+	turn_power = record.turn_power;
+	left_velocity_setpoint = record.left_velocity_setpoint;
+	right_velocity_setpoint = record.right_velocity_setpoint;
+	left_voltage = left_output_voltage = record.left_voltage;
+	right_voltage = right_output_voltage = record.right_voltage;
+
+	// Each controller's previous error is the last error it was given, which is either recorded directly or
+	// can be worked out from the recorded setpoints and sensor readings.
+	drive_controller.restore(record.drive_error, record.drive_integral);
+	turn_controller.restore(record.turn_error, record.turn_integral);
+	left_velocity_controller.restore(record.left_velocity_setpoint - record.sensors.left_velocity, record.left_velocity_integral);
+	right_velocity_controller.restore(record.right_velocity_setpoint - record.sensors.right_velocity, record.right_velocity_integral);
+
+	settle_counter = 0;
+	stall_timer = 0;
+	settled = move_status != MoveStatus::Moving;
+	aborted = move_status == MoveStatus::Stalled || move_status == MoveStatus::Collided;
+
+	// Stages are kept in phase with the recording, so each one runs on the same ticks that it did on the robot.
+	replay_scheduler->reset(record.tick + 1);
+	replaying = true;
+
+	mutex.unlock();
+
+	return true;
+}
+
+bool DifferentialDrivetrain::replay_tick(const FlightRecorder::Record& input, FlightRecorder::Record& output) {
+	lock_mutex();
+
+	// After a gap in the recording, the drivetrain's state no longer matches the tick, so nothing is replayed.
+	if (!replaying || replay_scheduler->get_tick_count() != input.tick) {
+		mutex.unlock();
+		return false;
+	}
+
+	apply_recorded_commands(input);
+	sensors = input.sensors;
+	path_target_set = input.path_target_set == 1;
+	path_target = Vector2(input.path_target_x, input.path_target_y);
+
+	env::Timer timer;
+	record_inputs(output, input.tick);
+	replay_scheduler->tick();
+	record_outputs(output);
+
+	output.tick_interval = input.tick_interval;
+	output.tick_duration = static_cast<uint32_t>(timer.elapsed());
+
+	mutex.unlock();
+
+	return true;
+}
+
+void DifferentialDrivetrain::end_replay() {
+	lock_mutex();
+	replaying = false;
+	replay_scheduler = nullptr;
+	mutex.unlock();
+}
+
+void DifferentialDrivetrain::apply_recorded_commands(const FlightRecorder::Record& record) {
+	// Movement functions are the only source of commands, and they always start a new move.
+	if (record.move_status == static_cast<uint8_t>(MoveStatus::Moving) && move_status != MoveStatus::Moving) {
+		begin_move("replay");
+	}
+
+	target_type = record.target_type == 1 ? TargetType::Point : TargetType::DistanceAndHeading;
+	target_position = Vector2(record.target_x, record.target_y);
+	target_distance = record.target_distance;
+	target_heading = record.target_heading;
+	max_drive_power = record.max_drive_power;
+	max_turn_power = record.max_turn_power;
+}
+
+// Telemetry
+
+void DifferentialDrivetrain::subscribe_telemetry(telemetry::Sink& sink) {
+	lock_mutex();
+	telemetry_publisher.subscribe(sink);
+	mutex.unlock();
+}
+
+void DifferentialDrivetrain::unsubscribe_telemetry(telemetry::Sink& sink) {
+	lock_mutex();
+	telemetry_publisher.unsubscribe(sink);
+	mutex.unlock();
+}
+
+void DifferentialDrivetrain::set_telemetry_period(telemetry::Channel channel, uint32_t period) {
+	lock_mutex();
+	telemetry_publisher.set_period(channel, period);
+	mutex.unlock();
 }
 
 void DifferentialDrivetrain::start_tracking(Vector2 position, double heading) {
@@ -450,11 +1408,6 @@ void DifferentialDrivetrain::start_tracking(Vector2 position, double heading) {
 		tracking_active = true;
 		tracking_thread = std::make_shared<env::Thread>(threading::make_member_thread(this, &DifferentialDrivetrain::tracking));
 	}
-	
-	if (!logging_active) {
-		logging_active = true;
-		logging_thread = std::make_shared<env::Thread>(threading::make_member_thread(this, &DifferentialDrivetrain::logging));
-	}
 }
 
 void DifferentialDrivetrain::reset_tracking(Vector2 position, double heading) {
@@ -464,13 +1417,25 @@ void DifferentialDrivetrain::reset_tracking(Vector2 position, double heading) {
 	if (left_encoder != nullptr) { env::encoder_reset_rotation(*left_encoder); }
 	if (right_encoder != nullptr) { env::encoder_reset_rotation(*right_encoder); }
 
-	if (imu != nullptr) {
-		while (env::imu_is_calibrating(*imu)) { env::sleep_for(100); }
+	lock_mutex();
+	if (imu != nullptr && is_imu_ready()) {
 		if (!imu_calibrated) {
-			logger.warning("IMU has not been calibrated! Heading may report inaccurate as a result. Call drivetrain.calibrate_imu() before the tracking period.");
+			TAO_LOG_WARNING(logger, "IMU has not been calibrated! Heading may report inaccurate as a result. Call drivetrain.calibrate_imu() before the tracking period.");
 		}
 		env::imu_reset_heading(*imu);
+
+		imu_active = true;
+		imu_heading_offset = heading;
+	} else {
+		// If the imu is still calibrating, then wheel heading is used until it finishes rather than
+		// blocking the start of the tracking period.
+		if (imu != nullptr && !imu_invalid) {
+			TAO_LOG_INFO(logger, "IMU is still calibrating. Using wheel heading until calibration finishes.");
+		}
+
+		imu_active = false;
 	}
+	mutex.unlock();
 
 	start_heading = heading;
 	this->position = position;
@@ -479,125 +1444,182 @@ void DifferentialDrivetrain::reset_tracking(Vector2 position, double heading) {
 }
 
 void DifferentialDrivetrain::stop_tracking() {
-	mutex.lock();
+	lock_mutex();
 
 	tracking_active = false;
-	logging_active = false;
-	
+
+	mutex.unlock();
+
+	// Nothing to stop if tracking was never started (or was already stopped).
+	if (tracking_thread == nullptr) return;
+
+	tracking_thread->join();
+	tracking_thread = nullptr;
+
+	// Write out the recording for the whole tracking period.
+	lock_mutex();
+	std::string path = recorder != nullptr ? recording_path : "";
+	recording_dump_pending = false;
 	mutex.unlock();
 
-	if (tracking_thread != nullptr) {
-		tracking_thread->join();
+	if (!path.empty()) dump_recording(path);
+}
+
+bool DifferentialDrivetrain::wait_until_settled(uint32_t timeout) {
+	TAO_TRACE_SCOPE("wait_until_settled");
+
+	env::Timer timer;
+
+	// Spinlock until settled
+	bool settled = true;
+	while (!is_settled()) {
+		if (timeout > 0 && timer.elapsed() >= static_cast<int64_t>(timeout) * 1000) {
+			settled = false;
+			break;
+		}
+
+		env::sleep_for(10);
+	}
+
+	// If the movement was aborted, write out the recording now that nothing is waiting on the drivetrain.
+	dump_pending_recording();
+
+	return settled;
+}
+
+// Move metrics
+
+std::vector<DifferentialDrivetrain::MoveMetrics> DifferentialDrivetrain::get_move_history() {
+	std::vector<MoveMetrics> history;
+
+	lock_mutex();
+	std::size_t count = move_history_count < MOVE_HISTORY_SIZE ? move_history_count : MOVE_HISTORY_SIZE;
+	history.reserve(count);
+	for (std::size_t i = move_history_count - count; i < move_history_count; i++) {
+		history.push_back(move_history[i % MOVE_HISTORY_SIZE]);
 	}
+	mutex.unlock();
+
+	return history;
+}
+
+void DifferentialDrivetrain::clear_move_history() {
+	lock_mutex();
+	move_history_count = 0;
+	mutex.unlock();
+}
 
-	if (logging_thread != nullptr) {
-		logging_thread->join();
+void DifferentialDrivetrain::log_move_history() {
+	std::vector<MoveMetrics> history = get_move_history();
+
+	TAO_LOG_INFO(logger, "%-12s %9s %9s %9s %9s %9s %9s %9s %7s  %s",
+		"move", "time(ms)", "reach(ms)", "settle", "drive os", "turn os", "drive err", "turn err", "peak V", "status");
+
+	for (const MoveMetrics& move : history) {
+		TAO_LOG_INFO(logger, "%-12s %9.1f %9.1f %9.1f %9.3f %9.3f %9.3f %9.3f %7.2f  %s",
+			move.name, (move.end_time - move.start_time) / 1000.0, move.reach_time / 1000.0, move.settle_time / 1000.0,
+			move.drive_overshoot, move.turn_overshoot, move.final_drive_error, move.final_turn_error,
+			move.peak_voltage, move.status == MoveStatus::Moving ? "replaced" : move_status_to_string(move.status));
 	}
 }
 
-void DifferentialDrivetrain::wait_until_settled() {
-	// Spinlock until settled
-	while (!is_settled()) { env::sleep_for(10); }
+const char* DifferentialDrivetrain::move_status_to_string(MoveStatus status) {
+	switch (status) {
+		case MoveStatus::Moving: return "moving";
+		case MoveStatus::Settled: return "settled";
+		case MoveStatus::Stalled: return "stalled";
+		case MoveStatus::Collided: return "collided";
+		default: return "unknown";
+	}
+}
+
+// Profiling
+
+profiling::Histogram::Stats DifferentialDrivetrain::get_timing(TimingStage stage) {
+	lock_mutex();
+	profiling::Histogram::Stats stats = timing(stage).get_stats();
+	mutex.unlock();
+	return stats;
+}
+
+void DifferentialDrivetrain::reset_timing() {
+	lock_mutex();
+	for (profiling::Histogram& histogram : timings) histogram.reset();
+	mutex.unlock();
 }
 
 // Movement
 
 void DifferentialDrivetrain::drive(double distance, bool blocking) {
-	mutex.lock();
-	settled = false;
+	lock_mutex();
+	begin_move("drive");
 	set_target(get_forward_travel() + distance, target_heading);
 	mutex.unlock();
 
-	logger.debug("Driving for %f", distance);
+	TAO_LOG_DEBUG(logger, "Driving for %f", distance);
 	if (blocking) wait_until_settled();
 }
 
 void DifferentialDrivetrain::turn_to(double heading, bool blocking) {
-	mutex.lock();
-	settled = false;
+	lock_mutex();
+	begin_move("turn_to");
 	set_target(target_distance, heading);
 	mutex.unlock();
 
-	logger.debug("Turning to %f\u00B0", heading);
+	TAO_LOG_DEBUG(logger, "Turning to %f\u00B0", heading);
 	if (blocking) wait_until_settled();
 }
 
 void DifferentialDrivetrain::turn_to(Vector2 point, bool blocking) {
-	mutex.lock();
-	settled = false;
+	lock_mutex();
+	begin_move("turn_to");
 	Vector2 local_target = point - position;
 	set_target(target_distance, local_target.get_angle());
 	mutex.unlock();
 
-	logger.debug("Turning to (%f, %f). Calculated angle: %f\u00B0", point.get_x(), point.get_y());
+	TAO_LOG_DEBUG(logger, "Turning to (%f, %f). Calculated angle: %f\u00B0", point.get_x(), point.get_y());
 	if (blocking) wait_until_settled();
 }
 
 void DifferentialDrivetrain::move_to(Vector2 point, bool blocking) {
-	mutex.lock();
-	settled = false;
+	lock_mutex();
+	begin_move("move_to");
 	set_target(point);
 	Vector2 position = this->position;
 	mutex.unlock();
 
-	logger.debug("Moving to (%f, %f). Distance: %f", point.get_x(), point.get_y(), point.distance(position));
+	TAO_LOG_DEBUG(logger, "Moving to (%f, %f). Distance: %f", point.get_x(), point.get_y(), point.distance(position));
 	if (blocking) wait_until_settled();
 }
 
-void DifferentialDrivetrain::follow_path(std::vector<Vector2> path) {
-	logger.debug("Following path.");
+void DifferentialDrivetrain::follow_path(std::vector<Vector2> path, bool blocking) {
+	TAO_LOG_DEBUG(logger, "Following path.");
 	
-	mutex.lock();
-	settled = false;
+	lock_mutex();
+	begin_move("follow_path");
 
 	// Add current position to the start of the path so that intersections can be found.
 	path.insert(path.begin(), position);
-	mutex.unlock();
 
-	// Loop through all waypoints in the provided path.
-	for (int i = 0; i < (path.size() - 1); i++) {
-		Vector2 start = path[i]; // The current waypoint
-		Vector2 end = path[i + 1]; // The next waypoint
-
-		while (position.distance(end) > lookahead_distance) {
-			mutex.lock();
-			// Find the point(s) of intersection between a circle centered around our global position with the radius of our
-			// lookahead distance and a line segment formed between our starting/ending points.
-			std::vector<Vector2> intersections = math::line_circle_intersections(position, lookahead_distance, start, end);
-
-			// Choose the best intersection to go to, ensuring that we don't go backwards along the path.
-			Vector2 target_intersection;
-			if (intersections.size() == 2) {
-				// There are two intersections. Find the one closest to the end of the line segment.
-				if (intersections[0].distance(end) < intersections[1].distance(end)) {
-					target_intersection = intersections[0];
-				} else {
-					target_intersection = intersections[1];
-				}
-			} else if (intersections.size() == 1) {
-				// There is one intersection. Go to that intersection.
-				target_intersection = intersections[0];
-			}
-
-			if (intersections.size() > 0) {
-				set_target(target_intersection);
-			}
+	this->path = std::move(path);
+	path_index = 0;
+	path_move_id = move_id;
+	following_path = true;
 
-			mutex.unlock();
-			
-			env::sleep_for(10);
-		}
-	}
+	// Aim for the first lookahead point straight away, rather than the previous movement's target until the next tick.
+	update_path(0.0);
+	mutex.unlock();
 
-	wait_until_settled();
+	if (blocking) wait_until_settled();
 }
 
 void DifferentialDrivetrain::hold_position() {
-	mutex.lock();
+	lock_mutex();
+	aborted = false;
 	set_target(get_forward_travel(), get_heading());
 	mutex.unlock();
 
-	logger.debug("Holding position. Forward Travel: %f, Heading: %f", get_forward_travel(), get_heading());
+	TAO_LOG_DEBUG(logger, "Holding position. Forward Travel: %f, Heading: %f", get_forward_travel(), get_heading());
 }
 
 } // namespace tao
\ No newline at end of file
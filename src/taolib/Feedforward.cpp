@@ -0,0 +1,75 @@
+/**
+ * @file src/taolib/Feedforward.cpp
+ * @author Tropical
+ *
+ * Open-loop voltage model for a DC motor driven mechanism.
+ */
+
+#include <cmath>
+
+#include "taolib/Feedforward.h"
+
+namespace tao {
+
+Feedforward::Feedforward(Gains gains) : gains(gains) {}
+Feedforward::Feedforward() : gains({ 0, 0, 0 }) {}
+
+void Feedforward::set_gains(const Gains& gains) { this->gains = gains; }
+Feedforward::Gains Feedforward::get_gains() const { return gains; }
+
+bool Feedforward::is_configured() const { return gains.kV != 0.0; }
+
+double Feedforward::calculate(double velocity, double acceleration) const {
+	double static_voltage = velocity > 0.0 ? gains.kS : (velocity < 0.0 ? -gains.kS : 0.0);
+
+	return static_voltage + (gains.kV * velocity) + (gains.kA * acceleration);
+}
+
+Feedforward::Regression::Regression() : xtx(), xty(), sample_count(0) {}
+
+int Feedforward::Regression::get_sample_count() const { return sample_count; }
+
+void Feedforward::Regression::add_sample(double voltage, double velocity, double acceleration) {
+	double x[3] = { velocity > 0.0 ? 1.0 : (velocity < 0.0 ? -1.0 : 0.0), velocity, acceleration };
+
+	for (int row = 0; row < 3; row++) {
+		for (int column = 0; column < 3; column++) {
+			xtx[row][column] += x[row] * x[column];
+		}
+		xty[row] += x[row] * voltage;
+	}
+
+	sample_count++;
+}
+
+Feedforward::Gains Feedforward::Regression::solve() const {
+	// Solve the 3x3 normal equations (XᵀX)β = Xᵀy using Cramer's rule.
+	auto determinant = [](const double m[3][3]) {
+		return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+			- m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+			+ m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+	};
+
+	double denominator = determinant(xtx);
+
+	// If the system is singular, then one of the regressors never varied (e.g. the mechanism never moved, or
+	// never accelerated), so the gains can't be separated from each other.
+	if (sample_count < 3 || std::abs(denominator) < 1e-12) {
+		return { 0, 0, 0 };
+	}
+
+	double solution[3];
+	for (int column = 0; column < 3; column++) {
+		double m[3][3];
+		for (int row = 0; row < 3; row++) {
+			for (int i = 0; i < 3; i++) {
+				m[row][i] = (i == column) ? xty[row] : xtx[row][i];
+			}
+		}
+		solution[column] = determinant(m) / denominator;
+	}
+
+	return { solution[0], solution[1], solution[2] };
+}
+
+} // namespace tao
@@ -0,0 +1,187 @@
+/**
+ * @file src/taolib/FlightRecorder.cpp
+ * @author Tropical
+ *
+ * Fixed-size history of every tracking loop tick, for diagnosing movements after a run.
+ */
+
+#include "taolib/FlightRecorder.h"
+#include "taolib/env.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+namespace tao {
+
+FlightRecorder::FlightRecorder(std::size_t capacity)
+	: records(new Record[capacity > 0 ? capacity : 1]),
+	  record_capacity(capacity > 0 ? capacity : 1),
+	  head(0),
+	  count(0),
+	  sequence(0),
+	  frozen(false) {}
+
+void FlightRecorder::record(const Record& record) {
+	if (frozen) return;
+
+	// Only the tracking thread adds records, so the sequence number doesn't need a read-modify-write.
+	sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	records[head] = record;
+	head = (head + 1) % record_capacity;
+	if (count < record_capacity) count++;
+}
+
+const FlightRecorder::Record& FlightRecorder::get(std::size_t index) const {
+	// The oldest record is at the head once the buffer has wrapped around.
+	std::size_t oldest = count < record_capacity ? 0 : head;
+	return records[(oldest + index) % record_capacity];
+}
+
+std::size_t FlightRecorder::size() const { return count; }
+std::size_t FlightRecorder::capacity() const { return record_capacity; }
+
+void FlightRecorder::clear() {
+	head = 0;
+	count = 0;
+
+	// Every record that was held counts as overwritten, so a dump in progress doesn't write the new ones in their place.
+	sequence.store(sequence.load(std::memory_order_relaxed) + static_cast<uint32_t>(record_capacity), std::memory_order_release);
+}
+
+void FlightRecorder::set_frozen(bool frozen) { this->frozen = frozen; }
+bool FlightRecorder::is_frozen() const { return frozen; }
+
+FlightRecorder::Snapshot FlightRecorder::snapshot() const {
+	Snapshot snapshot;
+	snapshot.count = count;
+	snapshot.start = (head + record_capacity - count) % record_capacity;
+	snapshot.first = sequence.load(std::memory_order_relaxed) - static_cast<uint32_t>(count);
+	return snapshot;
+}
+
+bool FlightRecorder::dump(const char* path, const Snapshot& snapshot, const char* preamble, std::size_t* dumped) const {
+	// Rows are batched into chunks, since each write to the SD card has a large fixed cost.
+	constexpr std::size_t CHUNK_SIZE = 4096;
+	constexpr std::size_t ROW_SIZE = 768;
+
+	// The first write truncates the file, and every write after it appends.
+	bool append = false;
+
+	if (preamble != nullptr) {
+		if (!env::file_write(path, preamble, std::strlen(preamble), append)) return false;
+		append = true;
+	}
+
+	char chunk[CHUNK_SIZE];
+	int length = snprintf(chunk, CHUNK_SIZE,
+		"tick,timestamp,left_travel,right_travel,left_velocity,right_velocity,imu_installed,imu_calibrating,imu_heading,"
+		"imu_acceleration_x,imu_acceleration_y,target_type,target_x,target_y,target_distance,target_heading,"
+		"max_drive_power,max_turn_power,move_status,path_target_set,path_target_x,path_target_y,x,y,heading,drive_error,turn_error,drive_power,turn_power,"
+		"left_velocity_setpoint,right_velocity_setpoint,left_voltage,right_voltage,drive_integral,turn_integral,"
+		"left_velocity_integral,right_velocity_integral,tick_interval,tick_duration\n");
+	std::size_t size = static_cast<std::size_t>(length);
+
+	std::size_t written = 0;
+
+	for (std::size_t i = 0; i < snapshot.count; i++) {
+		// The record is copied before it's checked, since recording may overwrite it at any time.
+		Record record = records[(snapshot.start + i) % record_capacity];
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		// Records are overwritten once the recorder has started record_capacity newer ones. If this one was, then
+		// skip ahead to the oldest record that's left.
+		uint32_t started = sequence.load(std::memory_order_relaxed) - (snapshot.first + static_cast<uint32_t>(i));
+		if (started > record_capacity) {
+			i += started - record_capacity - 1;
+			continue;
+		}
+
+		const SensorFrame& sensors = record.sensors;
+
+		// Inputs (and the controller integrals) are written at full precision so that a replay sees
+		// exactly the same values as the robot did.
+		length = snprintf(chunk + size, CHUNK_SIZE - size,
+			"%u,%u,%.17g,%.17g,%.17g,%.17g,%d,%d,%.17g,%.17g,%.17g,%u,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%u,%u,%.17g,%.17g,"
+			"%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.17g,%.17g,%.17g,%.17g,%u,%u\n",
+			static_cast<unsigned int>(record.tick),
+			static_cast<unsigned int>(sensors.timestamp),
+			sensors.left_travel, sensors.right_travel,
+			sensors.left_velocity, sensors.right_velocity,
+			sensors.imu_installed, sensors.imu_calibrating, sensors.imu_heading,
+			sensors.imu_acceleration_x, sensors.imu_acceleration_y,
+			static_cast<unsigned int>(record.target_type),
+			record.target_x, record.target_y, record.target_distance, record.target_heading,
+			record.max_drive_power, record.max_turn_power,
+			static_cast<unsigned int>(record.move_status),
+			static_cast<unsigned int>(record.path_target_set), record.path_target_x, record.path_target_y,
+			record.x, record.y, record.heading,
+			record.drive_error, record.turn_error,
+			record.drive_power, record.turn_power,
+			record.left_velocity_setpoint, record.right_velocity_setpoint,
+			record.left_voltage, record.right_voltage,
+			record.drive_integral, record.turn_integral,
+			record.left_velocity_integral, record.right_velocity_integral,
+			static_cast<unsigned int>(record.tick_interval), static_cast<unsigned int>(record.tick_duration));
+
+		if (length > 0) size += static_cast<std::size_t>(length);
+		written++;
+
+		if (CHUNK_SIZE - size < ROW_SIZE) {
+			if (!env::file_write(path, chunk, size, append)) return false;
+			append = true;
+			size = 0;
+		}
+	}
+
+	if (dumped != nullptr) *dumped = written;
+
+	return size == 0 || env::file_write(path, chunk, size, append);
+}
+
+bool FlightRecorder::parse(const char* row, Record& record) {
+	unsigned int tick, timestamp, target_type, move_status, path_target_set, tick_interval, tick_duration;
+	int imu_installed, imu_calibrating;
+	SensorFrame& sensors = record.sensors;
+
+	int fields = sscanf(row,
+		"%u,%u,%lf,%lf,%lf,%lf,%d,%d,%lf,%lf,%lf,%u,%lf,%lf,%lf,%lf,%lf,%lf,%u,%u,%lf,%lf,"
+		"%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%u,%u",
+		&tick, &timestamp,
+		&sensors.left_travel, &sensors.right_travel,
+		&sensors.left_velocity, &sensors.right_velocity,
+		&imu_installed, &imu_calibrating, &sensors.imu_heading,
+		&sensors.imu_acceleration_x, &sensors.imu_acceleration_y,
+		&target_type,
+		&record.target_x, &record.target_y, &record.target_distance, &record.target_heading,
+		&record.max_drive_power, &record.max_turn_power,
+		&move_status,
+		&path_target_set, &record.path_target_x, &record.path_target_y,
+		&record.x, &record.y, &record.heading,
+		&record.drive_error, &record.turn_error,
+		&record.drive_power, &record.turn_power,
+		&record.left_velocity_setpoint, &record.right_velocity_setpoint,
+		&record.left_voltage, &record.right_voltage,
+		&record.drive_integral, &record.turn_integral,
+		&record.left_velocity_integral, &record.right_velocity_integral,
+		&tick_interval, &tick_duration);
+
+	if (fields != 39) return false;
+
+	record.tick = tick;
+	sensors.timestamp = timestamp;
+	sensors.imu_installed = imu_installed != 0;
+	sensors.imu_calibrating = imu_calibrating != 0;
+	record.target_type = static_cast<uint8_t>(target_type);
+	record.move_status = static_cast<uint8_t>(move_status);
+	record.path_target_set = static_cast<uint8_t>(path_target_set);
+	record.tick_interval = tick_interval;
+	record.tick_duration = tick_duration;
+
+	return true;
+}
+
+} // namespace tao
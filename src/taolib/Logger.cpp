@@ -1,45 +1,243 @@
-#include "taolib/logger.h"
+#include "taolib/Logger.h"
+#include "taolib/threading.h"
+#include "taolib/trace.h"
+#include "taolib/env.h"
 
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <stdexcept>
-#include <functional>
 #include <vector>
 #include <cstdarg>
 #include <cstdio>
+#include <cstring>
+#include <cstdint>
 #include <memory>
+#include <atomic>
 
 namespace tao {
 
-Logger::Logger(std::ostream& output_stream, Level level)
-		: output_stream(output_stream), level(level) {}
+namespace {
 
-void Logger::set_level(Level level) { this->level = level; }
-void Logger::add_handle(const Handle& handle) { handles.push_back(handle); }
+// A single queued message.
+struct Record {
+	Logger::Level level;
+	bool raw;
+	std::size_t size;
+	char message[Logger::MESSAGE_SIZE];
+};
 
-void Logger::log(Level level, const char* format, va_list args) const {
-	if (level >= this->level) {
-		std::string message = this->format(format, args);
-		va_end(args);
+// Formats a message into a fixed-size buffer, truncating it if needed.
+// @return The length of the formatted message, excluding the null terminator.
+std::size_t format_message(char* buffer, std::size_t capacity, const char* format, va_list args) {
+	int length = vsnprintf(buffer, capacity, format, args);
+
+	if (length < 0) {
+		buffer[0] = '\0';
+		return 0;
+	}
+
+	return static_cast<std::size_t>(length) < capacity ? static_cast<std::size_t>(length) : capacity - 1;
+}
+
+} // namespace
+
+struct Logger::State {
+	std::ostream& output_stream;
+	Level level;
+	std::vector<Handle> handles;
 
+	// Asynchronous logging state.
+	std::unique_ptr<threading::MpscQueue<Record>> queue;
+	OverflowPolicy policy = OverflowPolicy::DropOldest;
+	std::atomic<bool> async_active;
+	std::atomic<int32_t> pending_producers;
+	std::atomic<uint32_t> dropped;
+	std::shared_ptr<env::Thread> drain_thread;
+
+	// Set to wake the drain thread early, so that stopping doesn't wait out the rest of a drain period.
+	threading::Event wake;
+
+	State(std::ostream& output_stream, Level level)
+		: output_stream(output_stream), level(level), async_active(false), pending_producers(0), dropped(0) {}
+
+	~State() { stop_async(); }
+
+	// Writes unformatted data straight to the output stream.
+	void emit_raw(const char* data, std::size_t size) {
+		output_stream.write(data, size);
+		output_stream.flush();
+	}
+
+	void emit(Level level, Message message) {
+		// Each part of the line is written straight to the stream, so nothing needs to be
+		// concatenated (and allocated) beforehand.
 		if (level == Level::TELEMETRY) {
-			output_stream
-				<< "\033[s[TAOLIB_BEGIN_TELEMETRY]"
-				<< message
-				<< "[TAOLIB_END_TELEMETRY]"
-				<< "\033[u\033[0j"
-				<< std::flush;
+			output_stream << "\033[s[TAOLIB_BEGIN_TELEMETRY]";
+			output_stream.write(message.data, message.size);
+			output_stream << "[TAOLIB_END_TELEMETRY]" << "\033[u\033[0j" << std::flush;
 		} else {
-			output_stream
-				<< colorize("[" + level_to_string(level) + "] " + message, level)
-				<< "\n";
+			output_stream << level_to_color(level) << "[" << level_to_string(level) << "] ";
+			output_stream.write(message.data, message.size);
+			output_stream << "\033[0m" << "\n";
 		}
 
 		for (auto& handle : handles) {
 			handle(level, message);
 		}
 	}
+
+	bool push(const Record& record) {
+		switch (policy) {
+			case OverflowPolicy::DropNewest:
+				if (!queue->try_push(record)) {
+					dropped.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+				return true;
+			case OverflowPolicy::DropOldest:
+				while (!queue->try_push(record)) {
+					// Evict the oldest record to make room. The queue supports multiple consumers,
+					// so this is safe to do alongside the drain thread.
+					Record evicted;
+					if (queue->try_pop(evicted)) {
+						dropped.fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+				return true;
+			case OverflowPolicy::Block:
+			default:
+				while (!queue->try_push(record)) { env::sleep_for(1); }
+				return true;
+		}
+	}
+
+	int drain() {
+		TAO_TRACE_THREAD_NAME("logger");
+
+		Record record;
+
+		while (true) {
+			// Check if we've been stopped *before* draining, so that anything pushed before
+			// the stop is guaranteed to be written out by this final pass.
+			bool finished = !async_active.load() && pending_producers.load() == 0;
+
+			// Only passes that actually write something are traced, to avoid filling the trace with empty ones.
+			if (queue->try_pop(record)) {
+				TAO_TRACE_SCOPE("drain");
+
+				do {
+					if (record.raw) {
+						emit_raw(record.message, record.size);
+					} else {
+						emit(record.level, { record.message, record.size });
+					}
+				} while (queue->try_pop(record));
+			}
+
+			uint32_t dropped_count = dropped.exchange(0, std::memory_order_relaxed);
+			if (dropped_count > 0) {
+				char message[64];
+				int length = snprintf(message, sizeof(message), "Logger queue overflowed. %u message(s) dropped.", static_cast<unsigned int>(dropped_count));
+				emit(Level::WARNING, { message, static_cast<std::size_t>(length) });
+			}
+
+			if (finished) break;
+
+			wake.wait(DRAIN_PERIOD);
+			wake.clear();
+		}
+
+		return 0;
+	}
+
+	void stop_async() {
+		if (drain_thread == nullptr) return;
+
+		async_active.store(false);
+		wake.set();
+		drain_thread->join();
+		drain_thread = nullptr;
+	}
+
+	// How often (in milliseconds) the drain thread writes out queued messages.
+	static constexpr uint32_t DRAIN_PERIOD = 10;
+};
+
+Logger::Logger(std::ostream& output_stream, Level level)
+		: state(std::make_shared<State>(output_stream, level)) {}
+
+void Logger::set_level(Level level) { state->level = level; }
+bool Logger::is_enabled(Level level) const {
+	return static_cast<int>(level) >= TAO_LOG_MIN_LEVEL && level >= state->level;
+}
+void Logger::add_handle(const Handle& handle) { state->handles.push_back(handle); }
+void Logger::add_handle(void (*function)(Level, Message)) { state->handles.push_back(Handle(function)); }
+
+void Logger::start_async(std::size_t capacity, OverflowPolicy policy) {
+	if (state->drain_thread != nullptr) return;
+
+	state->queue.reset(new threading::MpscQueue<Record>(capacity));
+	state->policy = policy;
+	state->async_active.store(true);
+
+	state->drain_thread = std::make_shared<env::Thread>(threading::make_member_thread(state.get(), &State::drain));
+	env::thread_set_priority(*state->drain_thread, env::THREAD_PRIORITY_LOW);
+}
+
+void Logger::stop_async() { state->stop_async(); }
+
+void Logger::log(Level level, const char* format, va_list args) const {
+	if (is_enabled(level)) {
+		// Register as a producer before checking if async logging is active, so that stop_async()
+		// can't finish draining the queue while this message is being pushed.
+		state->pending_producers.fetch_add(1);
+
+		if (state->async_active.load()) {
+			Record record;
+			record.level = level;
+			record.raw = false;
+			record.size = format_message(record.message, sizeof(record.message), format, args);
+
+			state->push(record);
+			state->pending_producers.fetch_sub(1);
+			return;
+		}
+
+		state->pending_producers.fetch_sub(1);
+
+		char message[MESSAGE_SIZE];
+		std::size_t size = format_message(message, sizeof(message), format, args);
+
+		state->emit(level, { message, size });
+	}
+}
+
+void Logger::write(const uint8_t* data, std::size_t size) const {
+	if (!is_enabled(Level::TELEMETRY)) return;
+
+	state->pending_producers.fetch_add(1);
+
+	if (state->async_active.load()) {
+		// Raw data is pushed as a single record so that it can't be interleaved with other messages.
+		if (size <= MESSAGE_SIZE) {
+			Record record;
+			record.level = Level::TELEMETRY;
+			record.raw = true;
+			record.size = size;
+			std::memcpy(record.message, data, size);
+
+			state->push(record);
+		} else {
+			state->dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		state->pending_producers.fetch_sub(1);
+		return;
+	}
+
+	state->pending_producers.fetch_sub(1);
+
+	state->emit_raw(reinterpret_cast<const char*>(data), size);
 }
 
 void Logger::telemetry(const char* format, ...) const {
@@ -84,7 +282,7 @@ void Logger::fatal(const char* format, ...) const {
 	va_end(args);
 }
 
-std::string Logger::level_to_string(Level level) {
+const char* Logger::level_to_string(Level level) {
 	switch (level) {
 		case Level::DEBUG:
 			return "DEBUG";
@@ -101,38 +299,21 @@ std::string Logger::level_to_string(Level level) {
 	}
 }
 
-std::string Logger::colorize(const std::string& message, Level level) {
+const char* Logger::level_to_color(Level level) {
 	switch (level) {
 		case Level::DEBUG:
-			return "\033[37m" + message + "\033[0m"; // white
+			return "\033[37m"; // white
 		case Level::INFO:
-			return "\033[36m" + message  + "\033[0m"; // cyan
+			return "\033[36m"; // cyan
 		case Level::WARNING:
-			return "\033[33m" + message + "\033[0m"; // yellow
+			return "\033[33m"; // yellow
 		case Level::ERROR:
-			return "\033[31m" + message + "\033[0m"; // red
+			return "\033[31m"; // red
 		case Level::FATAL:
-			return "\033[41m" + message + "\033[0m"; // red background
+			return "\033[41m"; // red background
 		default:
-			return message;
+			return "";
 	}
 }
 
-const std::string Logger::format(const char * const format, va_list args) {
-    // reliably acquire the size
-    // from a copy of the variable argument array
-    // and a functionally reliable call to mock the formatting
-    va_list args_copy;
-    va_copy(args_copy, args);
-    const int len = vsnprintf(NULL, 0, format, args_copy);
-    va_end(args_copy);
-
-    // return a formatted string without risking memory mismanagement
-    // and without assuming any compiler or platform specific behavior
-    std::vector<char> zc(len + 1);
-    vsnprintf(zc.data(), zc.size(), format, args);
-    va_end(args);
-    return std::string(zc.data(), len);
-}
-
 } // namespace tao
@@ -13,11 +13,18 @@
 
 namespace tao {
 
-PIDController::PIDController(Gains gains) : gains(gains), previous_error(0), integral(0) {}
-PIDController::PIDController() : gains({ 0, 0, 0 }), previous_error(0), integral(0) {}
+PIDController::PIDController(Gains gains) : gains(gains), previous_error(0), integral(0), terms({ 0, 0, 0 }) {}
+PIDController::PIDController() : gains({ 0, 0, 0 }), previous_error(0), integral(0), terms({ 0, 0, 0 }) {}
 
 void PIDController::set_gains(const Gains& gains) { this->gains = gains; }
 PIDController::Gains PIDController::get_gains() const { return gains; }
+PIDController::Terms PIDController::get_terms() const { return terms; }
+double PIDController::get_integral() const { return integral; }
+
+void PIDController::restore(double previous_error, double integral) {
+	this->previous_error = previous_error;
+	this->integral = integral;
+}
 
 double PIDController::update(double error, double delta_time) {
 	// Calculate the integral term if error is within i_threshold.
@@ -34,7 +41,8 @@ double PIDController::update(double error, double delta_time) {
 	double derivative = (error - previous_error) / delta_time;
 
 	// Calculate the PID output
-	double output = (gains.kP * error) + (gains.kI * integral) + (gains.kD * derivative);
+	terms = { gains.kP * error, gains.kI * integral, gains.kD * derivative };
+	double output = terms.proportional + terms.integral + terms.derivative;
 
 	// Update the previous error for the next iteration
 	previous_error = error;
@@ -0,0 +1,408 @@
+/**
+ * @file src/taolib/PointBuffer.cpp
+ * @author Tropical
+ *
+ * Structure-of-arrays storage for paths and other lists of points, with vectorized geometry queries.
+ */
+
+#include "taolib/PointBuffer.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#if TAO_SIMD && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define TAO_SIMD_NEON 1
+#elif TAO_SIMD && defined(__AVX__)
+#include <immintrin.h>
+#define TAO_SIMD_AVX 1
+#elif TAO_SIMD && defined(__SSE2__)
+#include <emmintrin.h>
+#define TAO_SIMD_SSE 1
+#endif
+
+namespace tao {
+
+namespace {
+
+// Operations on a group of floats, one set for each instruction set. Queries are written once in terms of these, and
+// run WIDTH points at a time.
+#if defined(TAO_SIMD_NEON)
+struct Lanes {
+	typedef float32x4_t Vec;
+	typedef uint32x4_t Mask;
+	enum { WIDTH = 4 };
+
+	static Vec load(const float* values) { return vld1q_f32(values); }
+	static void store(float* values, Vec v) { vst1q_f32(values, v); }
+	static Vec set(float value) { return vdupq_n_f32(value); }
+	static Vec offsets() { static const float values[4] = { 0, 1, 2, 3 }; return vld1q_f32(values); }
+
+	static Vec add(Vec a, Vec b) { return vaddq_f32(a, b); }
+	static Vec sub(Vec a, Vec b) { return vsubq_f32(a, b); }
+	static Vec mul(Vec a, Vec b) { return vmulq_f32(a, b); }
+	static Vec min(Vec a, Vec b) { return vminq_f32(a, b); }
+	static Vec max(Vec a, Vec b) { return vmaxq_f32(a, b); }
+
+	// ARMv7 NEON has no division or square root, so both are estimated and refined with two Newton-Raphson steps,
+	// which is accurate to within a few ulp.
+	static Vec div(Vec a, Vec b) {
+		Vec reciprocal = vrecpeq_f32(b);
+		reciprocal = vmulq_f32(reciprocal, vrecpsq_f32(b, reciprocal));
+		reciprocal = vmulq_f32(reciprocal, vrecpsq_f32(b, reciprocal));
+		return vmulq_f32(a, reciprocal);
+	}
+	static Vec sqrt(Vec a) {
+		Vec estimate = vrsqrteq_f32(a);
+		estimate = vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(a, estimate), estimate));
+		estimate = vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(a, estimate), estimate));
+		return vbslq_f32(vcgtq_f32(a, vdupq_n_f32(0)), vmulq_f32(a, estimate), vdupq_n_f32(0));
+	}
+
+	static Mask less(Vec a, Vec b) { return vcltq_f32(a, b); }
+	static Mask less_equal(Vec a, Vec b) { return vcleq_f32(a, b); }
+	static Mask both(Mask a, Mask b) { return vandq_u32(a, b); }
+	static Vec select(Mask mask, Vec a, Vec b) { return vbslq_f32(mask, a, b); }
+};
+#elif defined(TAO_SIMD_AVX)
+struct Lanes {
+	typedef __m256 Vec;
+	typedef __m256 Mask;
+	enum { WIDTH = 8 };
+
+	static Vec load(const float* values) { return _mm256_loadu_ps(values); }
+	static void store(float* values, Vec v) { _mm256_storeu_ps(values, v); }
+	static Vec set(float value) { return _mm256_set1_ps(value); }
+	static Vec offsets() { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+
+	static Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+	static Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+	static Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+	static Vec min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+	static Vec max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+	static Vec div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+	static Vec sqrt(Vec a) { return _mm256_sqrt_ps(_mm256_max_ps(a, _mm256_setzero_ps())); }
+
+	static Mask less(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static Mask less_equal(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	static Mask both(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+	static Vec select(Mask mask, Vec a, Vec b) { return _mm256_blendv_ps(b, a, mask); }
+};
+#elif defined(TAO_SIMD_SSE)
+struct Lanes {
+	typedef __m128 Vec;
+	typedef __m128 Mask;
+	enum { WIDTH = 4 };
+
+	static Vec load(const float* values) { return _mm_loadu_ps(values); }
+	static void store(float* values, Vec v) { _mm_storeu_ps(values, v); }
+	static Vec set(float value) { return _mm_set1_ps(value); }
+	static Vec offsets() { return _mm_setr_ps(0, 1, 2, 3); }
+
+	static Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+	static Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+	static Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+	static Vec min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+	static Vec max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+	static Vec div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+	static Vec sqrt(Vec a) { return _mm_sqrt_ps(_mm_max_ps(a, _mm_setzero_ps())); }
+
+	static Mask less(Vec a, Vec b) { return _mm_cmplt_ps(a, b); }
+	static Mask less_equal(Vec a, Vec b) { return _mm_cmple_ps(a, b); }
+	static Mask both(Mask a, Mask b) { return _mm_and_ps(a, b); }
+	static Vec select(Mask mask, Vec a, Vec b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+};
+#else
+struct Lanes {
+	typedef float Vec;
+	typedef bool Mask;
+	enum { WIDTH = 1 };
+
+	static Vec load(const float* values) { return *values; }
+	static void store(float* values, Vec v) { *values = v; }
+	static Vec set(float value) { return value; }
+	static Vec offsets() { return 0; }
+
+	static Vec add(Vec a, Vec b) { return a + b; }
+	static Vec sub(Vec a, Vec b) { return a - b; }
+	static Vec mul(Vec a, Vec b) { return a * b; }
+	static Vec min(Vec a, Vec b) { return a < b ? a : b; }
+	static Vec max(Vec a, Vec b) { return a > b ? a : b; }
+	static Vec div(Vec a, Vec b) { return a / b; }
+	static Vec sqrt(Vec a) { return a > 0 ? std::sqrt(a) : 0; }
+
+	static Mask less(Vec a, Vec b) { return a < b; }
+	static Mask less_equal(Vec a, Vec b) { return a <= b; }
+	static Mask both(Mask a, Mask b) { return a && b; }
+	static Vec select(Mask mask, Vec a, Vec b) { return mask ? a : b; }
+};
+#endif
+
+typedef Lanes::Vec Vec;
+typedef Lanes::Mask Mask;
+
+const std::size_t WIDTH = Lanes::WIDTH;
+
+// Finds the lane holding the smallest distance, preferring the lowest index among equal distances.
+std::size_t reduce_nearest(Vec distances, Vec indices, std::size_t* lane) {
+	float distance_values[WIDTH], index_values[WIDTH];
+	Lanes::store(distance_values, distances);
+	Lanes::store(index_values, indices);
+
+	std::size_t best = 0;
+	for (std::size_t i = 1; i < WIDTH; i++) {
+		if (distance_values[i] < distance_values[best]
+			|| (distance_values[i] == distance_values[best] && index_values[i] < index_values[best])) {
+			best = i;
+		}
+	}
+
+	if (lane != nullptr) *lane = best;
+	return static_cast<std::size_t>(index_values[best]);
+}
+
+} // namespace
+
+PointBuffer::PointBuffer() : count(0) {}
+
+PointBuffer::PointBuffer(const std::vector<Vector2>& points) : count(0) {
+	assign(points);
+}
+
+void PointBuffer::assign(const std::vector<Vector2>& points) {
+	count = 0;
+	reserve(points.size());
+
+	for (const Vector2& point : points) {
+		xs[count] = static_cast<float>(point.get_x());
+		ys[count] = static_cast<float>(point.get_y());
+		count++;
+	}
+
+	pad();
+}
+
+void PointBuffer::push_back(Vector2 point) {
+	reserve(count + 1);
+
+	xs[count] = static_cast<float>(point.get_x());
+	ys[count] = static_cast<float>(point.get_y());
+	count++;
+
+	pad();
+}
+
+void PointBuffer::reserve(std::size_t capacity) {
+	// Room for the padding after the last group of points.
+	std::size_t size = (capacity + PADDING - 1) / PADDING * PADDING + PADDING;
+
+	if (xs.size() < size) {
+		xs.resize(std::max(size, xs.size() * 2));
+		ys.resize(xs.size());
+	}
+}
+
+void PointBuffer::clear() {
+	count = 0;
+}
+
+void PointBuffer::pad() {
+	if (count == 0) return;
+
+	std::size_t end = (count + PADDING - 1) / PADDING * PADDING + PADDING;
+	std::fill(xs.begin() + count, xs.begin() + end, xs[count - 1]);
+	std::fill(ys.begin() + count, ys.begin() + end, ys[count - 1]);
+}
+
+void PointBuffer::distances_squared(Vector2 point, float* distances) const {
+	const Vec px = Lanes::set(static_cast<float>(point.get_x()));
+	const Vec py = Lanes::set(static_cast<float>(point.get_y()));
+
+	for (std::size_t i = 0; i < count; i += WIDTH) {
+		Vec dx = Lanes::sub(Lanes::load(&xs[i]), px);
+		Vec dy = Lanes::sub(Lanes::load(&ys[i]), py);
+		Vec distance = Lanes::add(Lanes::mul(dx, dx), Lanes::mul(dy, dy));
+
+		if (i + WIDTH <= count) {
+			Lanes::store(distances + i, distance);
+		} else {
+			float tail[WIDTH];
+			Lanes::store(tail, distance);
+			std::copy(tail, tail + (count - i), distances + i);
+		}
+	}
+}
+
+std::size_t PointBuffer::nearest_point(Vector2 point) const {
+	if (count == 0) return count;
+
+	const Vec px = Lanes::set(static_cast<float>(point.get_x()));
+	const Vec py = Lanes::set(static_cast<float>(point.get_y()));
+	const Vec step = Lanes::set(static_cast<float>(WIDTH));
+
+	Vec best_distance = Lanes::set(std::numeric_limits<float>::infinity());
+	Vec best_index = Lanes::set(0);
+	Vec index = Lanes::offsets();
+
+	for (std::size_t i = 0; i < count; i += WIDTH) {
+		Vec dx = Lanes::sub(Lanes::load(&xs[i]), px);
+		Vec dy = Lanes::sub(Lanes::load(&ys[i]), py);
+		Vec distance = Lanes::add(Lanes::mul(dx, dx), Lanes::mul(dy, dy));
+
+		Mask closer = Lanes::less(distance, best_distance);
+		best_distance = Lanes::select(closer, distance, best_distance);
+		best_index = Lanes::select(closer, index, best_index);
+
+		index = Lanes::add(index, step);
+	}
+
+	// Padding is a copy of the last point, so it can only tie with it, and loses to its lower index.
+	return std::min(reduce_nearest(best_distance, best_index, nullptr), count - 1);
+}
+
+std::size_t PointBuffer::nearest_segment(Vector2 point, double* t) const {
+	if (count < 2) return count;
+
+	const std::size_t segments = count - 1;
+
+	const Vec px = Lanes::set(static_cast<float>(point.get_x()));
+	const Vec py = Lanes::set(static_cast<float>(point.get_y()));
+	const Vec zero = Lanes::set(0);
+	const Vec one = Lanes::set(1);
+	const Vec step = Lanes::set(static_cast<float>(WIDTH));
+	const Vec segment_count = Lanes::set(static_cast<float>(segments));
+
+	Vec best_distance = Lanes::set(std::numeric_limits<float>::infinity());
+	Vec best_index = zero;
+	Vec best_t = zero;
+	Vec index = Lanes::offsets();
+
+	for (std::size_t i = 0; i < segments; i += WIDTH) {
+		Vec ax = Lanes::load(&xs[i]);
+		Vec ay = Lanes::load(&ys[i]);
+		Vec dx = Lanes::sub(Lanes::load(&xs[i + 1]), ax);
+		Vec dy = Lanes::sub(Lanes::load(&ys[i + 1]), ay);
+		Vec fx = Lanes::sub(px, ax);
+		Vec fy = Lanes::sub(py, ay);
+
+		// Project the point onto the segment, clamped to its ends. Segments between two equal points use their start.
+		Vec length_squared = Lanes::add(Lanes::mul(dx, dx), Lanes::mul(dy, dy));
+		Vec projection = Lanes::div(Lanes::add(Lanes::mul(fx, dx), Lanes::mul(fy, dy)), length_squared);
+		projection = Lanes::select(Lanes::less(zero, length_squared), projection, zero);
+		projection = Lanes::min(Lanes::max(projection, zero), one);
+
+		Vec cx = Lanes::sub(fx, Lanes::mul(projection, dx));
+		Vec cy = Lanes::sub(fy, Lanes::mul(projection, dy));
+		Vec distance = Lanes::add(Lanes::mul(cx, cx), Lanes::mul(cy, cy));
+
+		// Segments ending in the padding aren't part of the path, and are left out entirely.
+		Mask closer = Lanes::both(Lanes::less(distance, best_distance), Lanes::less(index, segment_count));
+		best_distance = Lanes::select(closer, distance, best_distance);
+		best_index = Lanes::select(closer, index, best_index);
+		best_t = Lanes::select(closer, projection, best_t);
+
+		index = Lanes::add(index, step);
+	}
+
+	std::size_t lane;
+	std::size_t nearest = reduce_nearest(best_distance, best_index, &lane);
+
+	if (t != nullptr) {
+		float t_values[WIDTH];
+		Lanes::store(t_values, best_t);
+		*t = t_values[lane];
+	}
+
+	return nearest;
+}
+
+std::size_t PointBuffer::intersect_circle(Vector2 center, double radius, float* t) const {
+	if (count < 2) return 0;
+
+	const std::size_t segments = count - 1;
+
+	const Vec cx = Lanes::set(static_cast<float>(center.get_x()));
+	const Vec cy = Lanes::set(static_cast<float>(center.get_y()));
+	const Vec radius_squared = Lanes::set(static_cast<float>(radius * radius));
+	const Vec zero = Lanes::set(0);
+	const Vec one = Lanes::set(1);
+	const Vec two = Lanes::set(2);
+	const Vec four = Lanes::set(4);
+	const Vec none = Lanes::set(-1);
+
+	for (std::size_t i = 0; i < segments; i += WIDTH) {
+		Vec ax = Lanes::load(&xs[i]);
+		Vec ay = Lanes::load(&ys[i]);
+		Vec dx = Lanes::sub(Lanes::load(&xs[i + 1]), ax);
+		Vec dy = Lanes::sub(Lanes::load(&ys[i + 1]), ay);
+		Vec fx = Lanes::sub(ax, cx);
+		Vec fy = Lanes::sub(ay, cy);
+
+		// Solve |a + t * d - center|^2 = radius^2 for t, as a quadratic a*t^2 + b*t + c = 0.
+		Vec a = Lanes::add(Lanes::mul(dx, dx), Lanes::mul(dy, dy));
+		Vec b = Lanes::mul(two, Lanes::add(Lanes::mul(fx, dx), Lanes::mul(fy, dy)));
+		Vec c = Lanes::sub(Lanes::add(Lanes::mul(fx, fx), Lanes::mul(fy, fy)), radius_squared);
+		Vec discriminant = Lanes::sub(Lanes::mul(b, b), Lanes::mul(four, Lanes::mul(a, c)));
+
+		Mask hit = Lanes::both(Lanes::less(zero, a), Lanes::less_equal(zero, discriminant));
+
+		Vec root = Lanes::sqrt(discriminant);
+		Vec denominator = Lanes::mul(two, a);
+		Vec t_far = Lanes::div(Lanes::sub(root, b), denominator);
+		Vec t_near = Lanes::div(Lanes::sub(zero, Lanes::add(b, root)), denominator);
+
+		// Prefer the intersection further along the segment, so that the path is never followed backwards.
+		Mask far_hit = Lanes::both(hit, Lanes::both(Lanes::less_equal(zero, t_far), Lanes::less_equal(t_far, one)));
+		Mask near_hit = Lanes::both(hit, Lanes::both(Lanes::less_equal(zero, t_near), Lanes::less_equal(t_near, one)));
+		Vec result = Lanes::select(far_hit, t_far, Lanes::select(near_hit, t_near, none));
+
+		if (i + WIDTH <= segments) {
+			Lanes::store(t + i, result);
+		} else {
+			float tail[WIDTH];
+			Lanes::store(tail, result);
+			std::copy(tail, tail + (segments - i), t + i);
+		}
+	}
+
+	std::size_t hits = 0;
+	for (std::size_t i = 0; i < segments; i++) {
+		if (t[i] >= 0) hits++;
+	}
+
+	return hits;
+}
+
+PointBuffer::BoundingBox PointBuffer::bounding_box() const {
+	if (count == 0) return BoundingBox();
+
+	Vec min_x = Lanes::load(&xs[0]);
+	Vec min_y = Lanes::load(&ys[0]);
+	Vec max_x = min_x;
+	Vec max_y = min_y;
+
+	for (std::size_t i = WIDTH; i < count; i += WIDTH) {
+		Vec x = Lanes::load(&xs[i]);
+		Vec y = Lanes::load(&ys[i]);
+		min_x = Lanes::min(min_x, x);
+		min_y = Lanes::min(min_y, y);
+		max_x = Lanes::max(max_x, x);
+		max_y = Lanes::max(max_y, y);
+	}
+
+	float min_xs[WIDTH], min_ys[WIDTH], max_xs[WIDTH], max_ys[WIDTH];
+	Lanes::store(min_xs, min_x);
+	Lanes::store(min_ys, min_y);
+	Lanes::store(max_xs, max_x);
+	Lanes::store(max_ys, max_y);
+
+	BoundingBox box = {
+		Vector2(*std::min_element(min_xs, min_xs + WIDTH), *std::min_element(min_ys, min_ys + WIDTH)),
+		Vector2(*std::max_element(max_xs, max_xs + WIDTH), *std::max_element(max_ys, max_ys + WIDTH))
+	};
+
+	return box;
+}
+
+} // namespace tao
@@ -0,0 +1,75 @@
+/**
+ * @file src/taolib/RateScheduler.cpp
+ * @author Tropical
+ *
+ * Runs a set of periodic stages at independent rates from a single thread.
+ */
+
+#include <cstdint>
+
+#include "taolib/RateScheduler.h"
+#include "taolib/env.h"
+
+namespace tao {
+
+RateScheduler::RateScheduler() {}
+
+void RateScheduler::add_stage(uint32_t period, const Stage& stage) {
+	if (period == 0) return;
+
+	stages.push_back({ period, stage });
+
+	// The base tick is the greatest common divisor of every stage's period, which is the slowest
+	// rate that still lands exactly on each stage's deadlines.
+	uint32_t a = tick_period, b = period;
+	while (b != 0) {
+		uint32_t remainder = a % b;
+		a = b;
+		b = remainder;
+	}
+	tick_period = a;
+}
+
+void RateScheduler::tick() {
+	for (auto& entry : stages) {
+		if (is_due(entry.period, ticks)) {
+			entry.stage(entry.period / 1000.0);
+		}
+	}
+
+	ticks++;
+}
+
+void RateScheduler::wait() {
+	int64_t remaining = -get_lateness();
+
+	if (remaining > 0) {
+		env::sleep_for(static_cast<uint32_t>((remaining + 999) / 1000));
+	} else if (-remaining >= static_cast<int64_t>(tick_period) * 1000) {
+		// We've fallen more than a full tick behind (the stages overran their budget). Rather than
+		// running a burst of back-to-back ticks to catch up, move the schedule forward.
+		timer.reset();
+		origin = ticks;
+	}
+}
+
+void RateScheduler::reset(uint64_t tick) {
+	ticks = tick;
+	origin = tick;
+	timer.reset();
+}
+
+uint64_t RateScheduler::get_tick_count() const { return ticks; }
+
+int64_t RateScheduler::get_lateness() const {
+	int64_t deadline = static_cast<int64_t>((ticks - origin) * tick_period) * 1000;
+	return timer.elapsed() - deadline;
+}
+
+bool RateScheduler::is_due(uint32_t period, uint64_t tick) const {
+	return (tick * tick_period) % period == 0;
+}
+
+uint32_t RateScheduler::get_tick_period() const { return tick_period; }
+
+} // namespace tao
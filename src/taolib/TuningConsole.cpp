@@ -0,0 +1,340 @@
+/**
+ * @file src/taolib/TuningConsole.cpp
+ * @author Tropical
+ *
+ * Command interpreter for tuning a drivetrain live over the serial connection.
+ */
+
+#include "taolib/TuningConsole.h"
+#include "taolib/threading.h"
+#include "taolib/trace.h"
+#include "taolib/env.h"
+
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+namespace tao {
+
+const TuningConsole::ParameterInfo TuningConsole::PARAMETERS[] = {
+	{ "drive_gains", Parameter::DriveGains, 4 },
+	{ "turn_gains", Parameter::TurnGains, 4 },
+	{ "velocity_gains", Parameter::VelocityGains, 4 },
+	{ "drive_tolerance", Parameter::DriveTolerance, 1 },
+	{ "turn_tolerance", Parameter::TurnTolerance, 1 },
+	{ "lookahead_distance", Parameter::LookaheadDistance, 1 },
+	{ "max_drive_power", Parameter::MaxDrivePower, 1 },
+	{ "max_turn_power", Parameter::MaxTurnPower, 1 },
+	{ "max_velocity", Parameter::MaxVelocity, 1 },
+};
+
+TuningConsole::TuningConsole(DifferentialDrivetrain& drivetrain, Logger logger)
+	: drivetrain(drivetrain), logger(logger), active(false) {}
+
+TuningConsole::~TuningConsole() { stop(); }
+
+void TuningConsole::start() {
+	if (thread != nullptr) return;
+
+	active.store(true);
+	thread = std::make_shared<env::Thread>(threading::make_member_thread(this, &TuningConsole::run));
+	env::thread_set_priority(*thread, env::THREAD_PRIORITY_LOW);
+
+	TAO_LOG_INFO(logger, "Tuning console started. Send \"help\" for a list of commands.");
+}
+
+void TuningConsole::stop() {
+	if (thread == nullptr) return;
+
+	active.store(false);
+	thread->join();
+	thread = nullptr;
+}
+
+int TuningConsole::run() {
+	TAO_TRACE_THREAD_NAME("tuning console");
+
+	while (active.load()) {
+		int32_t byte;
+		while ((byte = env::serial_read()) >= 0) {
+			if (byte == '\n' || byte == '\r') {
+				if (line_overflowed) {
+					TAO_LOG_WARNING(logger, "Command is too long. The longest command is %u characters.", static_cast<unsigned int>(LINE_SIZE - 1));
+				} else if (line_length > 0) {
+					line[line_length] = '\0';
+					execute(line);
+				}
+
+				line_length = 0;
+				line_overflowed = false;
+			} else if (line_length + 1 < LINE_SIZE) {
+				line[line_length++] = static_cast<char>(byte);
+			} else {
+				line_overflowed = true;
+			}
+		}
+
+		// Test movements are reported from here rather than waited on, so that they can be stopped with another command.
+		mutex.lock();
+		report_move();
+		mutex.unlock();
+
+		env::sleep_for(POLL_PERIOD);
+	}
+
+	return 0;
+}
+
+bool TuningConsole::execute(const char* command) {
+	// Split the command into words in place.
+	char buffer[LINE_SIZE];
+	snprintf(buffer, sizeof(buffer), "%s", command);
+
+	char* arguments[MAX_ARGUMENTS];
+	std::size_t argument_count = 0;
+
+	char* cursor = buffer;
+	while (argument_count < MAX_ARGUMENTS) {
+		while (*cursor == ' ' || *cursor == '\t') cursor++;
+		if (*cursor == '\0') break;
+
+		arguments[argument_count++] = cursor;
+
+		while (*cursor != '\0' && *cursor != ' ' && *cursor != '\t') cursor++;
+		if (*cursor != '\0') *cursor++ = '\0';
+	}
+
+	if (argument_count == 0) return false;
+
+	const char* name = arguments[0];
+	double values[2];
+	bool success = true;
+
+	mutex.lock();
+
+	if (std::strcmp(name, "help") == 0) {
+		log_help();
+	} else if (std::strcmp(name, "get") == 0 && argument_count <= 2) {
+		success = get(argument_count == 2 ? arguments[1] : nullptr);
+	} else if (std::strcmp(name, "set") == 0 && argument_count >= 3) {
+		success = set(arguments[1], arguments + 2, argument_count - 2);
+	} else if (std::strcmp(name, "drive") == 0 && argument_count == 2 && parse_number(arguments[1], values[0])) {
+		drivetrain.drive(values[0], false);
+		watch_move();
+	} else if (std::strcmp(name, "turn_to") == 0 && argument_count == 2 && parse_number(arguments[1], values[0])) {
+		drivetrain.turn_to(values[0], false);
+		watch_move();
+	} else if (std::strcmp(name, "turn_to") == 0 && argument_count == 3
+		&& parse_number(arguments[1], values[0]) && parse_number(arguments[2], values[1])) {
+		drivetrain.turn_to(Vector2(values[0], values[1]), false);
+		watch_move();
+	} else if (std::strcmp(name, "move_to") == 0 && argument_count == 3
+		&& parse_number(arguments[1], values[0]) && parse_number(arguments[2], values[1])) {
+		drivetrain.move_to(Vector2(values[0], values[1]), false);
+		watch_move();
+	} else if (std::strcmp(name, "stop") == 0 && argument_count == 1) {
+		drivetrain.hold_position();
+		watching_move = false;
+		TAO_LOG_INFO(logger, "Holding position.");
+	} else if (std::strcmp(name, "history") == 0 && argument_count == 1) {
+		drivetrain.log_move_history();
+	} else {
+		TAO_LOG_WARNING(logger, "Invalid command \"%s\". Send \"help\" for a list of commands.", command);
+		success = false;
+	}
+
+	mutex.unlock();
+
+	return success;
+}
+
+bool TuningConsole::get(const char* name) {
+	if (name == nullptr) {
+		for (const ParameterInfo& info : PARAMETERS) {
+			log_parameter(info);
+		}
+		return true;
+	}
+
+	const ParameterInfo* info = find_parameter(name);
+	if (info == nullptr) {
+		TAO_LOG_WARNING(logger, "Unknown parameter \"%s\".", name);
+		return false;
+	}
+
+	log_parameter(*info);
+	return true;
+}
+
+bool TuningConsole::set(const char* name, char** arguments, std::size_t argument_count) {
+	const ParameterInfo* info = find_parameter(name);
+	if (info == nullptr) {
+		TAO_LOG_WARNING(logger, "Unknown parameter \"%s\".", name);
+		return false;
+	}
+
+	if (argument_count > info->value_count) {
+		TAO_LOG_WARNING(logger, "%s takes at most %u value(s).", info->name, static_cast<unsigned int>(info->value_count));
+		return false;
+	}
+
+	// Values that aren't given keep their current value, so `set drive_gains 3.5` only changes kP.
+	double values[MAX_VALUES];
+	read_parameter(info->parameter, values);
+
+	for (std::size_t i = 0; i < argument_count; i++) {
+		if (!parse_number(arguments[i], values[i])) {
+			TAO_LOG_WARNING(logger, "\"%s\" is not a number.", arguments[i]);
+			return false;
+		}
+	}
+
+	write_parameter(info->parameter, values);
+	log_parameter(*info);
+	return true;
+}
+
+void TuningConsole::log_parameter(const ParameterInfo& info) {
+	double values[MAX_VALUES];
+	read_parameter(info.parameter, values);
+
+	char text[96];
+	std::size_t length = 0;
+	for (std::size_t i = 0; i < info.value_count && length < sizeof(text); i++) {
+		int written = snprintf(text + length, sizeof(text) - length, i == 0 ? "%g" : " %g", values[i]);
+		if (written > 0) length += static_cast<std::size_t>(written);
+	}
+
+	TAO_LOG_INFO(logger, "%s = %s", info.name, text);
+}
+
+void TuningConsole::read_parameter(Parameter parameter, double* values) {
+	PIDController::Gains gains = {};
+
+	switch (parameter) {
+		case Parameter::DriveGains:
+			gains = drivetrain.get_drive_gains();
+			break;
+		case Parameter::TurnGains:
+			gains = drivetrain.get_turn_gains();
+			break;
+		case Parameter::VelocityGains:
+			gains = drivetrain.get_velocity_gains();
+			break;
+		case Parameter::DriveTolerance:
+			values[0] = drivetrain.get_drive_tolerance();
+			return;
+		case Parameter::TurnTolerance:
+			values[0] = drivetrain.get_turn_tolerance();
+			return;
+		case Parameter::LookaheadDistance:
+			values[0] = drivetrain.get_lookahead_distance();
+			return;
+		case Parameter::MaxDrivePower:
+			values[0] = drivetrain.get_max_drive_power();
+			return;
+		case Parameter::MaxTurnPower:
+			values[0] = drivetrain.get_max_turn_power();
+			return;
+		case Parameter::MaxVelocity:
+			values[0] = drivetrain.get_max_velocity();
+			return;
+	}
+
+	values[0] = gains.kP;
+	values[1] = gains.kI;
+	values[2] = gains.kD;
+	values[3] = gains.i_threshold;
+}
+
+void TuningConsole::write_parameter(Parameter parameter, const double* values) {
+	PIDController::Gains gains = { values[0], values[1], values[2], values[3] };
+
+	switch (parameter) {
+		case Parameter::DriveGains:
+			drivetrain.set_drive_gains(gains);
+			break;
+		case Parameter::TurnGains:
+			drivetrain.set_turn_gains(gains);
+			break;
+		case Parameter::VelocityGains:
+			drivetrain.set_velocity_gains(gains);
+			break;
+		case Parameter::DriveTolerance:
+			drivetrain.set_drive_tolerance(values[0]);
+			break;
+		case Parameter::TurnTolerance:
+			drivetrain.set_turn_tolerance(values[0]);
+			break;
+		case Parameter::LookaheadDistance:
+			drivetrain.set_lookahead_distance(values[0]);
+			break;
+		case Parameter::MaxDrivePower:
+			drivetrain.set_max_drive_power(values[0]);
+			break;
+		case Parameter::MaxTurnPower:
+			drivetrain.set_max_turn_power(values[0]);
+			break;
+		case Parameter::MaxVelocity:
+			drivetrain.set_max_velocity(values[0]);
+			break;
+	}
+}
+
+void TuningConsole::watch_move() {
+	watching_move = true;
+	watched_move_id = drivetrain.get_move_id();
+}
+
+void TuningConsole::report_move() {
+	if (!watching_move) return;
+
+	if (drivetrain.get_move_id() == watched_move_id && drivetrain.get_move_status() == DifferentialDrivetrain::MoveStatus::Moving) {
+		return;
+	}
+
+	watching_move = false;
+
+	// The movement that just ended is the most recent one in the history.
+	std::vector<DifferentialDrivetrain::MoveMetrics> history = drivetrain.get_move_history();
+	if (history.empty()) return;
+
+	const DifferentialDrivetrain::MoveMetrics& move = history.back();
+	TAO_LOG_INFO(logger, "%s %s after %.1fms (reached %.1fms, settled %.1fms, overshoot %.3f/%.3f, final error %.3f/%.3f, peak %.2fV)",
+		move.name,
+		move.status == DifferentialDrivetrain::MoveStatus::Moving ? "replaced" : DifferentialDrivetrain::move_status_to_string(move.status),
+		(move.end_time - move.start_time) / 1000.0, move.reach_time / 1000.0, move.settle_time / 1000.0,
+		move.drive_overshoot, move.turn_overshoot, move.final_drive_error, move.final_turn_error, move.peak_voltage);
+}
+
+void TuningConsole::log_help() {
+	TAO_LOG_INFO(logger, "Commands:");
+	TAO_LOG_INFO(logger, "  get [parameter]           Show one parameter, or every parameter.");
+	TAO_LOG_INFO(logger, "  set <parameter> <values>  Change a parameter. Gains take kP kI kD i_threshold, and omitted values are kept.");
+	TAO_LOG_INFO(logger, "  drive <distance>          Drive forwards (or backwards) and report the result.");
+	TAO_LOG_INFO(logger, "  turn_to <heading>         Turn to a heading in degrees and report the result.");
+	TAO_LOG_INFO(logger, "  turn_to <x> <y>           Turn to face a point and report the result.");
+	TAO_LOG_INFO(logger, "  move_to <x> <y>           Move to a point and report the result.");
+	TAO_LOG_INFO(logger, "  stop                      Hold the current position.");
+	TAO_LOG_INFO(logger, "  history                   Show metrics for recent movements.");
+	TAO_LOG_INFO(logger, "Parameters: drive_gains, turn_gains, velocity_gains, drive_tolerance, turn_tolerance, lookahead_distance, max_drive_power, max_turn_power, max_velocity");
+}
+
+const TuningConsole::ParameterInfo* TuningConsole::find_parameter(const char* name) {
+	for (const ParameterInfo& info : PARAMETERS) {
+		if (std::strcmp(info.name, name) == 0) return &info;
+	}
+
+	return nullptr;
+}
+
+bool TuningConsole::parse_number(const char* text, double& value) {
+	char* end;
+	value = std::strtod(text, &end);
+	return end != text && *end == '\0';
+}
+
+} // namespace tao
@@ -0,0 +1,199 @@
+/**
+ * @file src/taolib/coroutine.cpp
+ * @author Tropical
+ *
+ * Coroutine-based autonomous routines.
+ */
+
+#include "taolib/coroutine.h"
+
+#if TAO_COROUTINES
+
+namespace tao {
+namespace coroutine {
+
+// Executor
+
+Executor::Executor(uint32_t period) : period(period) {}
+
+// Spawned routines are destroyed along with the executor, so nothing is left waiting on it.
+Executor::~Executor() {
+	waiters.clear();
+	spawned.clear();
+}
+
+void Executor::start(Task& task, Executor* executor, std::shared_ptr<internal::CancelToken> token) {
+	task.handle.promise().executor = executor;
+	task.handle.promise().token = std::move(token);
+	task.handle.resume();
+}
+
+void Executor::run(Task task) {
+	if (task.done()) return;
+
+	start(task, this, std::make_shared<internal::CancelToken>());
+
+	while (!task.done()) {
+		env::sleep_for(period);
+		poll();
+	}
+}
+
+void Executor::spawn(Task task) {
+	if (task.done()) return;
+
+	start(task, this, std::make_shared<internal::CancelToken>());
+	spawned.push_back(std::move(task));
+}
+
+void Executor::wait(std::function<bool()> ready, std::coroutine_handle<> handle, std::shared_ptr<internal::CancelToken> token) {
+	waiters.push_back({ std::move(ready), handle, std::move(token) });
+}
+
+void Executor::poll() {
+	// Resumed routines may start waiting again (or cancel other routines), so the current waiters are taken out of the
+	// list before any of them run.
+	std::vector<Waiter> pending;
+	pending.swap(waiters);
+
+	std::vector<Waiter> remaining;
+
+	for (Waiter& waiter : pending) {
+		// A cancelled routine's frame may already be destroyed, so nothing about it can be touched besides its token.
+		if (waiter.token->is_cancelled()) continue;
+
+		if (waiter.ready()) {
+			waiter.handle.resume();
+		} else {
+			remaining.push_back(std::move(waiter));
+		}
+	}
+
+	// Routines that started waiting during this poll are checked after the ones that were already waiting.
+	for (Waiter& waiter : waiters) {
+		remaining.push_back(std::move(waiter));
+	}
+	waiters.swap(remaining);
+
+	for (std::size_t i = 0; i < spawned.size();) {
+		if (spawned[i].done()) {
+			spawned.erase(spawned.begin() + i);
+		} else {
+			i++;
+		}
+	}
+}
+
+bool Executor::is_idle() const {
+	for (const Waiter& waiter : waiters) {
+		if (!waiter.token->is_cancelled()) return false;
+	}
+
+	return true;
+}
+
+// Awaitables
+
+Condition wait_until(std::function<bool()> ready) {
+	return Condition(std::move(ready));
+}
+
+Condition delay(uint32_t duration) {
+	// The timer starts once the delay is first awaited, rather than when it's created, so delays passed to when_all and
+	// when_any are measured from when those start.
+	std::shared_ptr<env::Timer> timer;
+
+	return Condition([timer, duration]() mutable {
+		if (timer == nullptr) timer = std::make_shared<env::Timer>();
+		return timer->elapsed() >= static_cast<int64_t>(duration) * 1000;
+	});
+}
+
+void Movement::await_suspend(std::coroutine_handle<Task::promise_type> handle) {
+	start();
+	id = drivetrain.get_move_id();
+
+	handle.promise().executor->wait([this]() {
+		return drivetrain.get_move_id() != id || drivetrain.get_move_status() != DifferentialDrivetrain::MoveStatus::Moving;
+	}, handle, handle.promise().token);
+}
+
+Movement drive(DifferentialDrivetrain& drivetrain, double distance) {
+	return Movement(drivetrain, [&drivetrain, distance]() { drivetrain.drive(distance, false); });
+}
+
+Movement turn_to(DifferentialDrivetrain& drivetrain, double heading) {
+	return Movement(drivetrain, [&drivetrain, heading]() { drivetrain.turn_to(heading, false); });
+}
+
+Movement turn_to(DifferentialDrivetrain& drivetrain, Vector2 point) {
+	return Movement(drivetrain, [&drivetrain, point]() { drivetrain.turn_to(point, false); });
+}
+
+Movement move_to(DifferentialDrivetrain& drivetrain, Vector2 point) {
+	return Movement(drivetrain, [&drivetrain, point]() { drivetrain.move_to(point, false); });
+}
+
+Movement follow_path(DifferentialDrivetrain& drivetrain, std::vector<Vector2> path) {
+	return Movement(drivetrain, [&drivetrain, path]() { drivetrain.follow_path(path, false); });
+}
+
+// Combinators
+
+bool WhenAll::await_ready() const {
+	for (const Task& task : tasks) {
+		if (!task.done()) return false;
+	}
+
+	return true;
+}
+
+bool WhenAll::await_suspend(std::coroutine_handle<Task::promise_type> handle) {
+	for (Task& task : tasks) {
+		Executor::start(task, handle.promise().executor, handle.promise().token);
+	}
+
+	// Every routine may have finished without waiting, in which case the awaiting routine continues right away.
+	if (await_ready()) return false;
+
+	handle.promise().executor->wait([this]() { return await_ready(); }, handle, handle.promise().token);
+	return true;
+}
+
+bool WhenAny::await_ready() const {
+	for (const Task& task : tasks) {
+		if (task.done()) return true;
+	}
+
+	return tasks.empty();
+}
+
+bool WhenAny::await_suspend(std::coroutine_handle<Task::promise_type> handle) {
+	token = std::make_shared<internal::CancelToken>();
+	token->parent = handle.promise().token;
+
+	for (Task& task : tasks) {
+		Executor::start(task, handle.promise().executor, token);
+		if (task.done()) return false;
+	}
+
+	handle.promise().executor->wait([this]() { return await_ready(); }, handle, handle.promise().token);
+	return true;
+}
+
+std::size_t WhenAny::await_resume() {
+	// The routines that are still running are destroyed along with this awaitable, so they're cancelled first to stop
+	// the executor from resuming them.
+	if (token != nullptr) token->cancelled = true;
+
+	for (std::size_t i = 0; i < tasks.size(); i++) {
+		if (tasks[i].done()) return i;
+	}
+
+	return 0;
+}
+
+} // namespace coroutine
+} // namespace tao
+
+#endif /* TAO_COROUTINES */
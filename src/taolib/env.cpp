@@ -10,15 +10,47 @@
 #include "taolib/math.h"
 
 #include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include <chrono>
+
+#ifdef TAO_ENV_PROS
+#include "pros/apix.h"
+#include <unistd.h>
+#elif defined(TAO_ENV_HOST)
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 namespace tao {
 namespace env {
 
+#ifndef TAO_ENV_HOST
+namespace {
+
+// Yielding only lets threads of the same priority run, so a thread waiting on one of a lower priority would never let
+// it finish. After a few attempts, waiting threads sleep instead to give every other thread a turn.
+constexpr uint32_t SPIN_ATTEMPTS = 16;
+
+void backoff(uint32_t attempt) {
+	if (attempt < SPIN_ATTEMPTS) {
+		thread_yield();
+	} else {
+		sleep_for(1);
+	}
+}
+
+} // namespace
+#endif
+
 #ifdef TAO_ENV_VEXCODE
 
 bool imu_is_installed(vex::inertial& imu) { return imu.installed(); }
 bool imu_is_calibrating(vex::inertial& imu) { return imu.isCalibrating(); }
 double imu_get_heading(vex::inertial& imu) { return imu.heading(vex::degrees); }
+double imu_get_rotation(vex::inertial& imu) { return imu.rotation(vex::degrees); }
+Vector2 imu_get_acceleration(vex::inertial& imu) { return Vector2(imu.acceleration(vex::xaxis), imu.acceleration(vex::yaxis)); }
 void imu_calibrate(vex::inertial& imu) { imu.calibrate(); }
 void imu_reset_heading(vex::inertial& imu) { imu.resetHeading(); }
 
@@ -28,6 +60,15 @@ void motor_group_set_voltage(vex::motor_group& group, double voltage) {
 double motor_group_get_rotation(vex::motor_group& group) {
 	return group.position(vex::degrees);
 }
+double motor_group_get_velocity(vex::motor_group& group) {
+	return group.velocity(vex::dps);
+}
+double motor_group_get_current(vex::motor_group& group) {
+	return group.current(vex::amp);
+}
+double motor_group_get_temperature(vex::motor_group& group) {
+	return group.temperature(vex::celsius);
+}
 void motor_group_reset_rotation(vex::motor_group& group) {
 	group.resetPosition();
 }
@@ -35,15 +76,61 @@ void motor_group_reset_rotation(vex::motor_group& group) {
 int32_t encoder_get_rotation(vex::encoder& encoder) {
 	return encoder.rotation(vex::degrees);
 }
+double encoder_get_velocity(vex::encoder& encoder) {
+	return encoder.velocity(vex::dps);
+}
 void encoder_reset_rotation(vex::encoder& encoder) {
 	encoder.resetRotation();
 }
 
+void thread_set_priority(vex::thread& thread, int32_t priority) {
+	thread.setPriority(priority);
+}
+uint32_t thread_current_id() {
+	return static_cast<uint32_t>(vex::this_thread::get_id());
+}
+void thread_yield() {
+	vex::this_thread::yield();
+}
+
+// VEXos has no blocking primitive besides mutexes (which must be unlocked by their owner), so the waiting thread
+// yields its time slice rather than immediately sleeping for a whole millisecond.
+Latch::Latch() : released(false) {}
+void Latch::release() {
+	released.store(true, std::memory_order_release);
+}
+void Latch::wait() {
+	for (uint32_t attempt = 0; !released.load(std::memory_order_acquire); attempt++) { backoff(attempt); }
+}
+
+int32_t serial_read() {
+	// Channel 1 is the user program's serial port, which stdin and stdout also use.
+	return vexSerialReadChar(1);
+}
+
+bool file_write(const char* path, const char* data, std::size_t size, bool append) {
+	static vex::brain brain;
+
+	if (!brain.SDcard.isInserted()) return false;
+
+	uint8_t* buffer = reinterpret_cast<uint8_t*>(const_cast<char*>(data));
+	int32_t written = append
+		? brain.SDcard.appendfile(path, buffer, static_cast<int32_t>(size))
+		: brain.SDcard.savefile(path, buffer, static_cast<int32_t>(size));
+
+	return written == static_cast<int32_t>(size);
+}
+
 #elif defined(TAO_ENV_PROS)
 
 bool imu_is_installed(pros::v5::Imu& imu) { return imu.is_installed(); }
 bool imu_is_calibrating(pros::v5::Imu& imu) { return imu.is_installed() && imu.is_calibrating(); }
 double imu_get_heading(pros::v5::Imu& imu) { return imu.get_heading(); }
+double imu_get_rotation(pros::v5::Imu& imu) { return imu.get_rotation(); }
+Vector2 imu_get_acceleration(pros::v5::Imu& imu) {
+	pros::imu_accel_s_t acceleration = imu.get_accel();
+	return Vector2(acceleration.x, acceleration.y);
+}
 void imu_calibrate(pros::v5::Imu& imu) { imu.reset(); }
 void imu_reset_heading(pros::v5::Imu& imu) { imu.tare_heading(); }
 
@@ -53,6 +140,21 @@ void motor_group_set_voltage(pros::v5::MotorGroup& group, double voltage) {
 double motor_group_get_rotation(pros::v5::MotorGroup& group) {
 	return math::vector_average(group.get_position_all());
 }
+double motor_group_get_velocity(pros::v5::MotorGroup& group) {
+	// PROS reports motor velocity in RPM, which is converted to degrees per second (360 / 60).
+	return math::vector_average(group.get_actual_velocity_all()) * 6.0;
+}
+double motor_group_get_current(pros::v5::MotorGroup& group) {
+	std::vector<int32_t> currents = group.get_current_draw_all();
+
+	// PROS reports current draw of each motor in milliamps.
+	double total = 0.0;
+	for (int32_t current : currents) { total += current / 1000.0; }
+	return total;
+}
+double motor_group_get_temperature(pros::v5::MotorGroup& group) {
+	return math::vector_average(group.get_temperature_all());
+}
 void motor_group_reset_rotation(pros::v5::MotorGroup& group) {
 	group.tare_position_all();
 }
@@ -60,10 +162,207 @@ void motor_group_reset_rotation(pros::v5::MotorGroup& group) {
 int32_t encoder_get_rotation(pros::adi::Encoder& encoder) {
 	return encoder.get_value();
 }
+namespace {
+
+// ADI encoders don't report velocity in PROS, so it's estimated from the change in position since the last time each
+// encoder was sampled. There are only 8 ADI ports on the brain, so a fixed table is enough to track every encoder.
+struct EncoderSample {
+	pros::adi::Encoder* encoder;
+	int32_t position;
+	uint64_t timestamp;
+	double velocity;
+};
+EncoderSample encoder_samples[8] = {};
+
+EncoderSample* find_encoder_sample(pros::adi::Encoder& encoder) {
+	for (EncoderSample& sample : encoder_samples) {
+		if (sample.encoder == &encoder || sample.encoder == nullptr) return &sample;
+	}
+	return nullptr;
+}
+
+} // namespace
+
+double encoder_get_velocity(pros::adi::Encoder& encoder) {
+	EncoderSample* sample = find_encoder_sample(encoder);
+	if (sample == nullptr) return 0.0;
+
+	// Samples are timed in microseconds, since a millisecond timestamp is off by up to 20% over a 5ms sensor period.
+	int32_t position = encoder.get_value();
+	uint64_t timestamp = high_resolution_clock();
+
+	if (sample->encoder == nullptr) {
+		*sample = { &encoder, position, timestamp, 0.0 };
+	} else if (timestamp > sample->timestamp) {
+		sample->velocity = (position - sample->position) * 1000000.0 / (timestamp - sample->timestamp);
+		sample->position = position;
+		sample->timestamp = timestamp;
+	}
+
+	return sample->velocity;
+}
 void encoder_reset_rotation(pros::adi::Encoder& encoder) {
 	encoder.reset();
+
+	// Start measuring again from the reset position, rather than seeing the reset as the encoder moving back to 0.
+	EncoderSample* sample = find_encoder_sample(encoder);
+	if (sample != nullptr) {
+		*sample = { &encoder, 0, high_resolution_clock(), 0.0 };
+	}
+}
+
+void thread_set_priority(pros::Task& thread, int32_t priority) {
+	thread.set_priority(priority);
+}
+uint32_t thread_current_id() {
+	// Tasks are identified by their handle, which stays the same for as long as the task is running.
+	return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(pros::c::task_get_current()));
+}
+void thread_yield() {
+	// A delay of zero yields in FreeRTOS.
+	pros::c::task_delay(0);
+}
+
+Latch::Latch() : released(false), waiter(pros::c::task_get_current()) {}
+void Latch::release() {
+	// The latch may be gone once it's marked as released, so the task to notify is read first.
+	pros::task_t task = waiter;
+	released.store(true, std::memory_order_release);
+	pros::c::task_notify(task);
+}
+void Latch::wait() {
+	while (!released.load(std::memory_order_acquire)) { pros::c::task_notify_take(true, TIMEOUT_MAX); }
+}
+
+int32_t serial_read() {
+	// stdin blocks until input arrives, so it's only read once the serial driver reports that something is waiting.
+	if (pros::c::fdctl(STDIN_FILENO, DEVCTL_FIONREAD, nullptr) <= 0) return -1;
+	return std::getchar();
+}
+
+bool file_write(const char* path, const char* data, std::size_t size, bool append) {
+	// The SD card is mounted at /usd/ in PROS.
+	char full_path[128];
+	snprintf(full_path, sizeof(full_path), "/usd/%s", path);
+
+	FILE* file = fopen(full_path, append ? "ab" : "wb");
+	if (file == nullptr) return false;
+
+	std::size_t written = fwrite(data, 1, size, file);
+	fclose(file);
+
+	return written == size;
+}
+
+#elif defined(TAO_ENV_HOST)
+
+void sleep_for(uint32_t duration) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(duration));
+}
+uint64_t high_resolution_clock() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()
+	).count();
+}
+
+bool imu_is_installed(host::IMU& imu) { return imu.installed; }
+bool imu_is_calibrating(host::IMU& imu) { return imu.calibrating; }
+double imu_get_heading(host::IMU& imu) { return imu.heading; }
+double imu_get_rotation(host::IMU& imu) { return imu.rotation; }
+Vector2 imu_get_acceleration(host::IMU& imu) { return Vector2(imu.acceleration_x, imu.acceleration_y); }
+void imu_calibrate(host::IMU& imu) { imu.calibrating = false; }
+void imu_reset_heading(host::IMU& imu) { imu.heading = 0.0; }
+
+void motor_group_set_voltage(host::MotorGroup& group, double voltage) { group.voltage = voltage; }
+double motor_group_get_rotation(host::MotorGroup& group) { return group.rotation; }
+double motor_group_get_velocity(host::MotorGroup& group) { return group.velocity; }
+double motor_group_get_current(host::MotorGroup& group) { return group.current; }
+double motor_group_get_temperature(host::MotorGroup& group) { return group.temperature; }
+void motor_group_reset_rotation(host::MotorGroup& group) { group.rotation = 0.0; }
+
+int32_t encoder_get_rotation(host::Encoder& encoder) { return encoder.rotation; }
+double encoder_get_velocity(host::Encoder& encoder) { return encoder.velocity; }
+void encoder_reset_rotation(host::Encoder& encoder) { encoder.rotation = 0; }
+
+void thread_set_priority(std::thread&, int32_t) {}
+uint32_t thread_current_id() {
+	return static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+void thread_yield() {
+	std::this_thread::yield();
 }
 
+Latch::Latch() : released(false) {}
+void Latch::release() {
+	// Notifying while holding the lock keeps the waiting thread from destroying the latch until this is done with it.
+	std::lock_guard<std::mutex> lock(mutex);
+	released.store(true, std::memory_order_release);
+	condition.notify_one();
+}
+void Latch::wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [this] { return released.load(std::memory_order_acquire); });
+}
+
+int32_t serial_read() {
+	// Standard input stands in for the serial port, and is polled so that reading never blocks.
+	pollfd descriptor = { STDIN_FILENO, POLLIN, 0 };
+	if (poll(&descriptor, 1, 0) <= 0 || !(descriptor.revents & POLLIN)) return -1;
+
+	unsigned char byte;
+	return read(STDIN_FILENO, &byte, 1) == 1 ? byte : -1;
+}
+
+Notifier::Notifier() : generation(0) {}
+uint32_t Notifier::prepare_wait() const {
+	return generation.load(std::memory_order_acquire);
+}
+void Notifier::wait(uint32_t token, uint32_t timeout) {
+	std::unique_lock<std::mutex> lock(mutex);
+	auto notified = [this, token] { return generation.load(std::memory_order_acquire) != token; };
+
+	if (timeout == 0) {
+		condition.wait(lock, notified);
+	} else {
+		condition.wait_for(lock, std::chrono::milliseconds(timeout), notified);
+	}
+}
+void Notifier::notify_all() {
+	std::lock_guard<std::mutex> lock(mutex);
+	generation.fetch_add(1, std::memory_order_acq_rel);
+	condition.notify_all();
+}
+
+bool file_write(const char* path, const char* data, std::size_t size, bool append) {
+	FILE* file = fopen(path, append ? "ab" : "wb");
+	if (file == nullptr) return false;
+
+	std::size_t written = fwrite(data, 1, size, file);
+	fclose(file);
+
+	return written == size;
+}
+
+#endif
+
+#ifndef TAO_ENV_HOST
+// Neither VEXos nor the PROS API has a primitive that can wake many threads at once, so waiters watch the generation
+// counter instead, backing off to sleeping once a few yields go by without a notification.
+Notifier::Notifier() : generation(0) {}
+uint32_t Notifier::prepare_wait() const {
+	return generation.load(std::memory_order_acquire);
+}
+void Notifier::wait(uint32_t token, uint32_t timeout) {
+	Timer timer;
+
+	for (uint32_t attempt = 0; generation.load(std::memory_order_acquire) == token; attempt++) {
+		if (timeout > 0 && timer.elapsed() >= static_cast<int64_t>(timeout) * 1000) return;
+		backoff(attempt);
+	}
+}
+void Notifier::notify_all() {
+	generation.fetch_add(1, std::memory_order_acq_rel);
+}
 #endif
 
 Timer::Timer(): timestamp(env::high_resolution_clock()) {}
@@ -0,0 +1,150 @@
+/**
+ * @file src/taolib/geometry.cpp
+ * @author Tropical
+ *
+ * Intersection, distance and containment tests for segments, circles, polylines and polygons.
+ */
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "taolib/geometry.h"
+#include "taolib/math.h"
+
+namespace tao {
+namespace geometry {
+
+Intersections<2> segment_circle_intersections(Vector2 start, Vector2 end, Vector2 center, double radius) {
+	Intersections<2> intersections;
+	intersections.count = 0;
+
+	// Solve |start + direction * t - center| = radius for t, as a quadratic a*t^2 + b*t + c = 0.
+	Vector2 direction = end - start;
+	Vector2 offset = start - center;
+
+	double a = direction.dot(direction);
+	double b = 2.0 * offset.dot(direction);
+	double c = offset.dot(offset) - radius * radius;
+
+	if (a == 0.0) return intersections;
+
+	double discriminant = b * b - 4.0 * a * c;
+	if (discriminant < 0.0) return intersections;
+
+	double root = std::sqrt(discriminant);
+	double solutions[2] = { (-b - root) / (2.0 * a), (-b + root) / (2.0 * a) };
+
+	// A tangent line has a single (repeated) solution.
+	std::size_t solution_count = discriminant == 0.0 ? 1 : 2;
+
+	// Solutions are ordered by t already, and only those between the segment's endpoints are on the segment.
+	for (std::size_t i = 0; i < solution_count; i++) {
+		double t = solutions[i];
+		if (t < 0.0 || t > 1.0) continue;
+
+		intersections.t[intersections.count] = t;
+		intersections.points[intersections.count] = start + direction * t;
+		intersections.count++;
+	}
+
+	return intersections;
+}
+
+Intersections<1> segment_intersection(Vector2 start_1, Vector2 end_1, Vector2 start_2, Vector2 end_2) {
+	Intersections<1> intersection;
+	intersection.count = 0;
+
+	Vector2 direction_1 = end_1 - start_1;
+	Vector2 direction_2 = end_2 - start_2;
+
+	double denominator = direction_1.cross(direction_2);
+	if (denominator == 0.0) return intersection;
+
+	Vector2 offset = start_2 - start_1;
+	double t = offset.cross(direction_2) / denominator; // Along the first segment
+	double u = offset.cross(direction_1) / denominator; // Along the second segment
+
+	if (t < 0.0 || t > 1.0 || u < 0.0 || u > 1.0) return intersection;
+
+	intersection.count = 1;
+	intersection.t[0] = t;
+	intersection.points[0] = start_1 + direction_1 * t;
+
+	return intersection;
+}
+
+Vector2 closest_point_on_segment(Vector2 start, Vector2 end, Vector2 point, double* t) {
+	Vector2 direction = end - start;
+	double length_squared = direction.get_magnitude_squared();
+
+	// A segment of zero length is just its start point.
+	double projection = 0.0;
+	if (length_squared > 0.0) {
+		projection = (point - start).dot(direction) / length_squared;
+		projection = math::clamp(projection, 0.0, 1.0);
+	}
+
+	if (t != nullptr) *t = projection;
+
+	return start + direction * projection;
+}
+
+double distance_to_polyline(const Vector2* points, std::size_t count, Vector2 point, std::size_t* segment, double* t) {
+	if (count == 0) return std::numeric_limits<double>::infinity();
+
+	if (count == 1) {
+		if (segment != nullptr) *segment = 0;
+		if (t != nullptr) *t = 0.0;
+		return point.distance(points[0]);
+	}
+
+	// Segments are compared by squared distance, so only the closest one takes a square root.
+	double best_distance = std::numeric_limits<double>::infinity();
+	std::size_t best_segment = 0;
+	double best_t = 0.0;
+
+	for (std::size_t i = 0; i + 1 < count; i++) {
+		double segment_t;
+		double distance = point.distance_squared(closest_point_on_segment(points[i], points[i + 1], point, &segment_t));
+
+		if (distance < best_distance) {
+			best_distance = distance;
+			best_segment = i;
+			best_t = segment_t;
+		}
+	}
+
+	if (segment != nullptr) *segment = best_segment;
+	if (t != nullptr) *t = best_t;
+
+	return std::sqrt(best_distance);
+}
+
+double distance_to_polyline(const std::vector<Vector2>& points, Vector2 point, std::size_t* segment, double* t) {
+	return distance_to_polyline(points.data(), points.size(), point, segment, t);
+}
+
+bool polygon_contains(const Vector2* vertices, std::size_t count, Vector2 point) {
+	// Count how many edges a ray from the point (going in the +x direction) crosses. An odd number means it's inside.
+	bool inside = false;
+
+	for (std::size_t i = 0, j = count - 1; i < count; j = i++) {
+		Vector2 a = vertices[i];
+		Vector2 b = vertices[j];
+
+		if ((a.get_y() > point.get_y()) != (b.get_y() > point.get_y())) {
+			double crossing_x = a.get_x() + (point.get_y() - a.get_y()) * (b.get_x() - a.get_x()) / (b.get_y() - a.get_y());
+			if (point.get_x() < crossing_x) inside = !inside;
+		}
+	}
+
+	return inside;
+}
+
+bool polygon_contains(const std::vector<Vector2>& vertices, Vector2 point) {
+	return polygon_contains(vertices.data(), vertices.size(), point);
+}
+
+} // namespace geometry
+} // namespace tao
@@ -0,0 +1,109 @@
+/**
+ * @file src/taolib/profiling.cpp
+ * @author Tropical
+ *
+ * Lightweight timing instrumentation for hot code paths.
+ */
+
+#include "taolib/profiling.h"
+#include "taolib/env.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+namespace tao {
+namespace profiling {
+
+Histogram::Histogram(uint32_t budget) : budget(budget) { reset(); }
+
+void Histogram::record(uint32_t duration) {
+	buckets[bucket_index(duration)]++;
+
+	if (count == 0 || duration < min) min = duration;
+	if (duration > max) max = duration;
+
+	count++;
+	total += duration;
+
+	if (budget > 0 && duration > budget) overruns++;
+}
+
+void Histogram::reset() {
+	for (uint32_t& bucket : buckets) bucket = 0;
+
+	count = 0;
+	min = 0;
+	max = 0;
+	total = 0;
+	overruns = 0;
+}
+
+uint32_t Histogram::get_percentile(double percentile) const {
+	if (count == 0) return 0;
+
+	// Find the first bucket where the running total of samples reaches the percentile's rank.
+	uint32_t rank = static_cast<uint32_t>(std::ceil(percentile / 100.0 * count));
+	if (rank < 1) rank = 1;
+	if (rank > count) rank = count;
+
+	uint32_t seen = 0;
+	for (std::size_t i = 0; i < BUCKET_COUNT; i++) {
+		seen += buckets[i];
+
+		if (seen >= rank) {
+			uint32_t bound = bucket_upper_bound(i);
+			if (bound > max) return max;
+			if (bound < min) return min;
+			return bound;
+		}
+	}
+
+	return max;
+}
+
+Histogram::Stats Histogram::get_stats() const {
+	Stats stats = {};
+	if (count == 0) return stats;
+
+	stats.count = count;
+	stats.min = min;
+	stats.max = max;
+	stats.mean = static_cast<double>(total) / count;
+	stats.p50 = get_percentile(50.0);
+	stats.p90 = get_percentile(90.0);
+	stats.p99 = get_percentile(99.0);
+	stats.overruns = overruns;
+
+	return stats;
+}
+
+uint32_t Histogram::get_budget() const { return budget; }
+void Histogram::set_budget(uint32_t budget) { this->budget = budget; }
+
+std::size_t Histogram::bucket_index(uint32_t duration) {
+	// Durations under 4us get a bucket each. Above that, each power of two is split into four
+	// buckets using the two bits below its most significant bit.
+	if (duration < 4) return duration;
+
+	uint32_t exponent = 31 - __builtin_clz(duration);
+	return 4 * (exponent - 1) + ((duration >> (exponent - 2)) & 3);
+}
+
+uint32_t Histogram::bucket_upper_bound(std::size_t index) {
+	if (index < 4) return static_cast<uint32_t>(index);
+
+	uint32_t exponent = static_cast<uint32_t>(index / 4) + 1;
+	uint64_t mantissa = 4 + index % 4;
+
+	return static_cast<uint32_t>(((mantissa + 1) << (exponent - 2)) - 1);
+}
+
+ScopedTimer::ScopedTimer(Histogram& histogram) : histogram(histogram), start(env::high_resolution_clock()) {}
+
+ScopedTimer::~ScopedTimer() {
+	histogram.record(static_cast<uint32_t>(env::high_resolution_clock() - start));
+}
+
+} // namespace profiling
+} // namespace tao
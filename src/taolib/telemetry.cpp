@@ -0,0 +1,354 @@
+/**
+ * @file src/taolib/telemetry.cpp
+ * @author Tropical
+ *
+ * Compact binary telemetry frames for streaming drivetrain state over a slow serial link.
+ */
+
+#include "taolib/telemetry.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace tao {
+namespace telemetry {
+
+namespace {
+
+// Frame types, stored in the first byte of every frame.
+constexpr uint8_t KEYFRAME = 0x01;
+constexpr uint8_t DELTA_FRAME = 0x02;
+
+// Quantization scales (the number of integer steps per unit).
+constexpr double POSITION_SCALE = 1000.0; // 0.001 distance units
+constexpr double ANGLE_SCALE = 100.0; // 0.01 degrees
+constexpr double OUTPUT_SCALE = 100.0; // 0.01%
+constexpr double VOLTAGE_SCALE = 1000.0; // 1mV
+
+// Quantized fields of a sample, in the order they are written to a frame.
+struct Field {
+	double Sample::*member;
+	double scale;
+};
+
+constexpr std::size_t FIELD_COUNT = 13;
+
+const Field FIELDS[FIELD_COUNT] = {
+	{ &Sample::x, POSITION_SCALE },
+	{ &Sample::y, POSITION_SCALE },
+	{ &Sample::heading, ANGLE_SCALE },
+	{ &Sample::drive_error, POSITION_SCALE },
+	{ &Sample::turn_error, ANGLE_SCALE },
+	{ &Sample::drive_p, OUTPUT_SCALE },
+	{ &Sample::drive_i, OUTPUT_SCALE },
+	{ &Sample::drive_d, OUTPUT_SCALE },
+	{ &Sample::turn_p, OUTPUT_SCALE },
+	{ &Sample::turn_i, OUTPUT_SCALE },
+	{ &Sample::turn_d, OUTPUT_SCALE },
+	{ &Sample::left_voltage, VOLTAGE_SCALE },
+	{ &Sample::right_voltage, VOLTAGE_SCALE },
+};
+
+// Frame layout before COBS encoding: type, schema version, sequence number, then the timestamp and
+// each field as zigzag varints (at most 5 bytes each), followed by a CRC-16.
+constexpr std::size_t HEADER_SIZE = 3;
+constexpr std::size_t CRC_SIZE = 2;
+constexpr std::size_t MAX_PAYLOAD_SIZE = HEADER_SIZE + (FIELD_COUNT + 1) * 5 + CRC_SIZE;
+
+// COBS adds one byte per 254 bytes of payload (plus one), and each frame is surrounded by delimiters.
+static_assert(MAX_PAYLOAD_SIZE + MAX_PAYLOAD_SIZE / 254 + 1 + 2 <= MAX_FRAME_SIZE, "MAX_FRAME_SIZE is too small for the frame layout.");
+
+int32_t quantize(double value, double scale) {
+	double scaled = std::round(value * scale);
+
+	if (scaled > INT32_MAX) return INT32_MAX;
+	if (scaled < INT32_MIN) return INT32_MIN;
+	if (std::isnan(scaled)) return 0;
+
+	return static_cast<int32_t>(scaled);
+}
+
+// Maps signed integers to unsigned ones so that values close to zero (positive or negative) encode to few bytes.
+uint32_t zigzag_encode(int32_t value) {
+	return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t zigzag_decode(uint32_t value) {
+	return static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+std::size_t write_varint(uint32_t value, uint8_t* buffer) {
+	std::size_t size = 0;
+
+	while (value >= 0x80) {
+		buffer[size++] = static_cast<uint8_t>(value | 0x80);
+		value >>= 7;
+	}
+	buffer[size++] = static_cast<uint8_t>(value);
+
+	return size;
+}
+
+// @return The number of bytes read, or 0 if the varint is truncated or malformed.
+std::size_t read_varint(const uint8_t* buffer, std::size_t size, uint32_t& value) {
+	value = 0;
+
+	for (std::size_t i = 0; i < size && i < 5; i++) {
+		value |= static_cast<uint32_t>(buffer[i] & 0x7F) << (7 * i);
+		if ((buffer[i] & 0x80) == 0) return i + 1;
+	}
+
+	return 0;
+}
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF).
+uint16_t crc16(const uint8_t* data, std::size_t size) {
+	uint16_t crc = 0xFFFF;
+
+	for (std::size_t i = 0; i < size; i++) {
+		crc ^= static_cast<uint16_t>(data[i]) << 8;
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+		}
+	}
+
+	return crc;
+}
+
+// Consistent Overhead Byte Stuffing removes every zero byte from the data, so that zero can be used
+// as an unambiguous frame delimiter.
+// @return The size of the encoded data.
+std::size_t cobs_encode(const uint8_t* data, std::size_t size, uint8_t* output) {
+	std::size_t code_index = 0;
+	std::size_t output_index = 1;
+	uint8_t code = 1;
+
+	for (std::size_t i = 0; i < size; i++) {
+		if (data[i] == 0) {
+			output[code_index] = code;
+			code_index = output_index++;
+			code = 1;
+		} else {
+			output[output_index++] = data[i];
+			code++;
+
+			if (code == 0xFF) {
+				output[code_index] = code;
+				code_index = output_index++;
+				code = 1;
+			}
+		}
+	}
+
+	output[code_index] = code;
+
+	return output_index;
+}
+
+// Decodes COBS data in place.
+// @return The size of the decoded data, or 0 if the data is malformed.
+std::size_t cobs_decode(uint8_t* data, std::size_t size) {
+	std::size_t input_index = 0;
+	std::size_t output_index = 0;
+
+	while (input_index < size) {
+		uint8_t code = data[input_index++];
+
+		if (code == 0 || input_index + code - 1 > size) return 0;
+
+		for (uint8_t i = 1; i < code; i++) {
+			data[output_index++] = data[input_index++];
+		}
+
+		if (code != 0xFF && input_index < size) {
+			data[output_index++] = 0;
+		}
+	}
+
+	return output_index;
+}
+
+} // namespace
+
+Publisher::Publisher() : periods{ 20, 10, 1000 }, elapsed(), due() { reset(); }
+
+void Publisher::set_period(Channel channel, uint32_t period) { periods[static_cast<std::size_t>(channel)] = period; }
+uint32_t Publisher::get_period(Channel channel) const { return periods[static_cast<std::size_t>(channel)]; }
+
+void Publisher::subscribe(Sink& sink) {
+	if (std::find(sinks.begin(), sinks.end(), &sink) == sinks.end()) {
+		sinks.push_back(&sink);
+	}
+}
+
+void Publisher::unsubscribe(Sink& sink) {
+	sinks.erase(std::remove(sinks.begin(), sinks.end(), &sink), sinks.end());
+}
+
+void Publisher::reset() {
+	for (std::size_t i = 0; i < CHANNEL_COUNT; i++) {
+		elapsed[i] = periods[i];
+		due[i] = false;
+	}
+}
+
+void Publisher::tick(uint32_t elapsed) {
+	for (std::size_t i = 0; i < CHANNEL_COUNT; i++) {
+		due[i] = false;
+		if (periods[i] == 0) continue;
+
+		this->elapsed[i] += elapsed;
+
+		if (this->elapsed[i] >= periods[i]) {
+			due[i] = true;
+
+			// Carry over the remainder so the average rate is exact, but don't try to catch up on
+			// more than one missed period (which would publish the same data several times in a row).
+			this->elapsed[i] = std::min(this->elapsed[i] - periods[i], periods[i]);
+		}
+	}
+}
+
+bool Publisher::is_due(Channel channel) const { return due[static_cast<std::size_t>(channel)] && !sinks.empty(); }
+
+void Publisher::publish(const Pose& pose) const {
+	for (Sink* sink : sinks) { sink->on_pose(pose); }
+}
+
+void Publisher::publish(const Sample& sample) const {
+	for (Sink* sink : sinks) { sink->on_state(sample); }
+}
+
+void Publisher::publish(const Gains& gains) const {
+	for (Sink* sink : sinks) { sink->on_gains(gains); }
+}
+
+FrameEncoder::FrameEncoder(uint32_t keyframe_interval)
+	: keyframe_interval(keyframe_interval > 0 ? keyframe_interval : 1), frame_count(0), sequence(0), previous() {}
+
+void FrameEncoder::reset() { frame_count = 0; }
+
+std::size_t FrameEncoder::encode(const Sample& sample, uint8_t* buffer, std::size_t capacity) {
+	if (capacity < MAX_FRAME_SIZE) return 0;
+
+	bool keyframe = frame_count % keyframe_interval == 0;
+
+	uint8_t payload[MAX_PAYLOAD_SIZE];
+	std::size_t size = 0;
+
+	payload[size++] = keyframe ? KEYFRAME : DELTA_FRAME;
+	payload[size++] = SCHEMA_VERSION;
+	payload[size++] = sequence;
+
+	// The timestamp and fields are written either as absolute values or as deltas from the previous frame.
+	// Deltas wrap around on overflow, which the decoder undoes by wrapping the same way.
+	int32_t values[FIELD_COUNT + 1];
+	values[0] = static_cast<int32_t>(sample.timestamp);
+	for (std::size_t i = 0; i < FIELD_COUNT; i++) {
+		values[i + 1] = quantize(sample.*FIELDS[i].member, FIELDS[i].scale);
+	}
+
+	for (std::size_t i = 0; i < FIELD_COUNT + 1; i++) {
+		uint32_t value = keyframe ? static_cast<uint32_t>(values[i]) : static_cast<uint32_t>(values[i]) - static_cast<uint32_t>(previous[i]);
+		size += write_varint(zigzag_encode(static_cast<int32_t>(value)), payload + size);
+		previous[i] = values[i];
+	}
+
+	uint16_t crc = crc16(payload, size);
+	payload[size++] = static_cast<uint8_t>(crc & 0xFF);
+	payload[size++] = static_cast<uint8_t>(crc >> 8);
+
+	// A leading delimiter terminates any text that was written to the stream since the last frame.
+	std::size_t frame_size = 0;
+	buffer[frame_size++] = 0;
+	frame_size += cobs_encode(payload, size, buffer + frame_size);
+	buffer[frame_size++] = 0;
+
+	frame_count++;
+	sequence++;
+
+	return frame_size;
+}
+
+FrameDecoder::FrameDecoder()
+	: size(0), overflowed(false), synchronized(false), sequence(0), previous(), lost_frames(0) {}
+
+uint32_t FrameDecoder::get_lost_frames() const { return lost_frames; }
+
+bool FrameDecoder::push(uint8_t byte, Sample& sample) {
+	if (byte != 0) {
+		if (size < MAX_FRAME_SIZE) {
+			buffer[size++] = byte;
+		} else {
+			overflowed = true;
+		}
+
+		return false;
+	}
+
+	// A delimiter was reached. Anything too long to be a frame is just text from the same stream.
+	bool decoded = size > 0 && !overflowed && decode_frame(sample);
+
+	size = 0;
+	overflowed = false;
+
+	return decoded;
+}
+
+bool FrameDecoder::decode_frame(Sample& sample) {
+	std::size_t payload_size = cobs_decode(buffer, size);
+
+	if (payload_size < HEADER_SIZE + CRC_SIZE) return false;
+
+	uint16_t crc = static_cast<uint16_t>(buffer[payload_size - 2] | (buffer[payload_size - 1] << 8));
+	payload_size -= CRC_SIZE;
+
+	// Text between frames fails this check, so it isn't counted as a lost frame.
+	if (crc16(buffer, payload_size) != crc) return false;
+
+	uint8_t type = buffer[0];
+	if ((type != KEYFRAME && type != DELTA_FRAME) || buffer[1] != SCHEMA_VERSION) return false;
+
+	uint8_t frame_sequence = buffer[2];
+	if (synchronized) {
+		lost_frames += static_cast<uint8_t>(frame_sequence - sequence - 1);
+	}
+
+	// Delta frames can't be decoded after a gap, so wait for the next keyframe.
+	if (type == DELTA_FRAME && (!synchronized || frame_sequence != static_cast<uint8_t>(sequence + 1))) {
+		synchronized = false;
+		lost_frames++;
+		return false;
+	}
+
+	int32_t values[FIELD_COUNT + 1];
+	std::size_t offset = HEADER_SIZE;
+
+	for (std::size_t i = 0; i < FIELD_COUNT + 1; i++) {
+		uint32_t encoded;
+		std::size_t length = read_varint(buffer + offset, payload_size - offset, encoded);
+		if (length == 0) return false;
+		offset += length;
+
+		int32_t value = zigzag_decode(encoded);
+		values[i] = type == KEYFRAME ? value : static_cast<int32_t>(static_cast<uint32_t>(previous[i]) + static_cast<uint32_t>(value));
+	}
+
+	std::memcpy(previous, values, sizeof(previous));
+	sequence = frame_sequence;
+	synchronized = true;
+
+	sample.timestamp = static_cast<uint32_t>(values[0]);
+	for (std::size_t i = 0; i < FIELD_COUNT; i++) {
+		sample.*FIELDS[i].member = values[i + 1] / FIELDS[i].scale;
+	}
+
+	return true;
+}
+
+} // namespace telemetry
+} // namespace tao
@@ -0,0 +1,215 @@
+/**
+ * @file src/taolib/threading.cpp
+ * @author Tropical
+ *
+ * Events for waking threads, and a scheduler that runs periodic tasks on a small pool of threads.
+ */
+
+#include "taolib/threading.h"
+#include "taolib/trace.h"
+#include "taolib/env.h"
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace tao {
+namespace threading {
+
+// Event
+
+Event::Event(bool set) : flag(set) {}
+
+void Event::set() {
+  flag.store(true, std::memory_order_release);
+  notifier.notify_all();
+}
+
+void Event::clear() { flag.store(false, std::memory_order_release); }
+
+bool Event::is_set() const { return flag.load(std::memory_order_acquire); }
+
+bool Event::wait(uint32_t timeout) {
+  env::Timer timer;
+
+  while (true) {
+    uint32_t token = notifier.prepare_wait();
+    if (is_set()) return true;
+
+    uint32_t remaining = 0;
+    if (timeout > 0) {
+      int64_t elapsed = timer.elapsed() / 1000;
+      if (elapsed >= timeout) return false;
+      remaining = timeout - static_cast<uint32_t>(elapsed);
+    }
+
+    notifier.wait(token, remaining);
+  }
+}
+
+bool Event::consume() { return flag.exchange(false, std::memory_order_acq_rel); }
+
+// TaskScheduler
+
+TaskScheduler::TaskScheduler(std::size_t thread_count, int32_t thread_priority)
+    : thread_count(thread_count > 0 ? thread_count : 1), thread_priority(thread_priority) {}
+
+TaskScheduler::~TaskScheduler() { stop(); }
+
+int32_t TaskScheduler::add_task(const char* name, uint32_t period, const Task& task, int32_t priority, uint32_t deadline) {
+  if (period == 0) return -1;
+
+  std::unique_ptr<Entry> entry(new Entry());
+  entry->name = name;
+  entry->task = task;
+  entry->period = period;
+  entry->deadline = deadline > 0 ? deadline : period;
+  entry->priority = priority;
+  entry->running = false;
+  entry->removed = false;
+  entry->runs = 0;
+  entry->overruns = 0;
+  entry->skipped = 0;
+  entry->jitter.set_budget(entry->deadline * 1000);
+  entry->duration.set_budget(entry->deadline * 1000);
+
+  mutex.lock();
+  entry->release = timer.elapsed();
+  entries.push_back(std::move(entry));
+  int32_t id = static_cast<int32_t>(entries.size() - 1);
+  mutex.unlock();
+
+  return id;
+}
+
+void TaskScheduler::remove_task(int32_t id) {
+  mutex.lock();
+  if (id >= 0 && static_cast<std::size_t>(id) < entries.size()) {
+    entries[id]->removed = true;
+  }
+  mutex.unlock();
+}
+
+void TaskScheduler::start() {
+  mutex.lock();
+  if (active) {
+    mutex.unlock();
+    return;
+  }
+  active = true;
+  mutex.unlock();
+
+  for (std::size_t i = 0; i < thread_count; i++) {
+    threads.push_back(std::make_shared<env::Thread>(make_member_thread(this, &TaskScheduler::worker)));
+    env::thread_set_priority(*threads.back(), thread_priority);
+  }
+}
+
+void TaskScheduler::stop() {
+  mutex.lock();
+  active = false;
+  mutex.unlock();
+
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  threads.clear();
+}
+
+TaskScheduler::Stats TaskScheduler::get_stats(int32_t id) {
+  Stats stats = {};
+
+  mutex.lock();
+  if (id >= 0 && static_cast<std::size_t>(id) < entries.size()) {
+    const Entry& entry = *entries[id];
+    stats.runs = entry.runs;
+    stats.overruns = entry.overruns;
+    stats.skipped = entry.skipped;
+    stats.jitter = entry.jitter.get_stats();
+    stats.duration = entry.duration.get_stats();
+  }
+  mutex.unlock();
+
+  return stats;
+}
+
+TaskScheduler::Entry* TaskScheduler::next_entry(int64_t now, int64_t& next_release) {
+  // Earliest deadline first, among the tasks that have been released and aren't already running on another worker.
+  Entry* next = nullptr;
+  int64_t next_deadline = 0;
+
+  for (auto& entry : entries) {
+    if (entry->removed || entry->running) continue;
+
+    if (entry->release > now) {
+      if (entry->release < next_release) next_release = entry->release;
+      continue;
+    }
+
+    int64_t deadline = entry->release + static_cast<int64_t>(entry->deadline) * 1000;
+    if (next == nullptr || deadline < next_deadline || (deadline == next_deadline && entry->priority > next->priority)) {
+      next = entry.get();
+      next_deadline = deadline;
+    }
+  }
+
+  return next;
+}
+
+int TaskScheduler::worker() {
+  TAO_TRACE_THREAD_NAME("task scheduler");
+
+  mutex.lock();
+
+  while (active) {
+    int64_t now = timer.elapsed();
+    int64_t next_release = now + static_cast<int64_t>(MAX_IDLE_SLEEP) * 1000;
+
+    Entry* entry = next_entry(now, next_release);
+
+    if (entry == nullptr) {
+      mutex.unlock();
+      int64_t remaining = next_release - now;
+      env::sleep_for(static_cast<uint32_t>(remaining > 1000 ? (remaining + 999) / 1000 : 1));
+      mutex.lock();
+      continue;
+    }
+
+    entry->running = true;
+    mutex.unlock();
+
+    int64_t start = timer.elapsed();
+    {
+      TAO_TRACE_SCOPE(entry->name);
+      entry->task();
+    }
+    int64_t end = timer.elapsed();
+
+    mutex.lock();
+    entry->running = false;
+    entry->runs++;
+    entry->jitter.record(static_cast<uint32_t>(start - entry->release));
+    entry->duration.record(static_cast<uint32_t>(end - start));
+
+    if (end > entry->release + static_cast<int64_t>(entry->deadline) * 1000) {
+      entry->overruns++;
+    }
+
+    // Release the next run one period later. If the task has fallen more than a period behind,
+    // skip the missed releases rather than running them back-to-back to catch up.
+    int64_t period = static_cast<int64_t>(entry->period) * 1000;
+    entry->release += period;
+    if (entry->release + period <= end) {
+      int64_t missed = (end - entry->release) / period;
+      entry->skipped += static_cast<uint32_t>(missed);
+      entry->release += missed * period;
+    }
+  }
+
+  mutex.unlock();
+  return 0;
+}
+
+} // namespace threading
+} // namespace tao
@@ -0,0 +1,213 @@
+/**
+ * @file src/taolib/trace.cpp
+ * @author Tropical
+ *
+ * Timeline of events across every thread, exported in the Chrome trace event format.
+ */
+
+#include "taolib/trace.h"
+#include "taolib/env.h"
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+
+namespace tao {
+namespace trace {
+
+namespace {
+
+struct Event {
+	// Microseconds since tracing started.
+	uint32_t timestamp;
+	uint32_t thread;
+	uint32_t id;
+	const char* name;
+
+	// Written last, so that a dump running alongside a writer can skip events that are still being filled in.
+	std::atomic<char> phase;
+};
+
+struct ThreadName {
+	uint32_t thread;
+	const char* name;
+};
+
+constexpr std::size_t MAX_THREAD_NAMES = 16;
+
+// Guards starting, stopping and dumping. Recording an event never takes this lock.
+env::Mutex control_mutex;
+
+std::unique_ptr<Event[]> events;
+std::size_t capacity = 0;
+uint64_t start_time = 0;
+
+std::atomic<std::size_t> next_event(0);
+std::atomic<uint32_t> dropped_events(0);
+std::atomic<bool> active(false);
+
+// Writers register themselves before checking that tracing is active, so stop() can wait for them to finish.
+std::atomic<int32_t> pending_writers(0);
+
+ThreadName thread_names[MAX_THREAD_NAMES];
+std::size_t thread_name_count = 0;
+
+void push(char phase, const char* name, uint32_t id) {
+	pending_writers.fetch_add(1);
+
+	if (active.load()) {
+		std::size_t index = next_event.fetch_add(1, std::memory_order_relaxed);
+
+		if (index < capacity) {
+			Event& event = events[index];
+			event.timestamp = static_cast<uint32_t>(env::high_resolution_clock() - start_time);
+			event.thread = env::thread_current_id();
+			event.id = id;
+			event.name = name;
+			event.phase.store(phase, std::memory_order_release);
+		} else {
+			dropped_events.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	pending_writers.fetch_sub(1);
+}
+
+} // namespace
+
+bool start(std::size_t event_capacity) {
+	control_mutex.lock();
+
+	if (active.load()) {
+		control_mutex.unlock();
+		return false;
+	}
+
+	events.reset(new Event[event_capacity > 0 ? event_capacity : 1]);
+	capacity = event_capacity > 0 ? event_capacity : 1;
+
+	for (std::size_t i = 0; i < capacity; i++) {
+		events[i].phase.store(0, std::memory_order_relaxed);
+	}
+
+	next_event.store(0);
+	dropped_events.store(0);
+	start_time = env::high_resolution_clock();
+	active.store(true);
+
+	control_mutex.unlock();
+	return true;
+}
+
+void stop() {
+	control_mutex.lock();
+
+	active.store(false);
+	while (pending_writers.load() > 0) { env::sleep_for(1); }
+
+	control_mutex.unlock();
+}
+
+bool is_active() { return active.load(); }
+
+std::size_t size() {
+	std::size_t count = next_event.load();
+	return count < capacity ? count : capacity;
+}
+
+uint32_t dropped() { return dropped_events.load(); }
+
+void set_thread_name(const char* name) {
+	uint32_t thread = env::thread_current_id();
+
+	control_mutex.lock();
+
+	// Thread ids can be reused once a thread exits, in which case the new thread's name replaces the old one.
+	std::size_t index = 0;
+	while (index < thread_name_count && thread_names[index].thread != thread) index++;
+
+	if (index < MAX_THREAD_NAMES) {
+		thread_names[index] = { thread, name };
+		if (index == thread_name_count) thread_name_count++;
+	}
+
+	control_mutex.unlock();
+}
+
+void begin(const char* name) { push('B', name, 0); }
+void end(const char* name) { push('E', name, 0); }
+void instant(const char* name) { push('i', name, 0); }
+void async_begin(const char* name, uint32_t id) { push('b', name, id); }
+void async_end(const char* name, uint32_t id) { push('e', name, id); }
+
+bool dump(const char* path) {
+	constexpr std::size_t CHUNK_SIZE = 4096;
+	constexpr std::size_t EVENT_SIZE = 192;
+
+	control_mutex.lock();
+
+	char chunk[CHUNK_SIZE];
+	std::size_t size = 0;
+	bool append = false;
+	bool success = true;
+
+	// Events are separated by commas, so every event after the first is prefixed with one.
+	const char* separator = "";
+
+	// Writes out the chunk once there might not be room for another event.
+	auto flush = [&](bool force) {
+		if (!success || size == 0 || (!force && CHUNK_SIZE - size >= EVENT_SIZE)) return;
+		success = env::file_write(path, chunk, size, append);
+		append = true;
+		size = 0;
+	};
+
+	auto write = [&](int length) {
+		if (length > 0) size += static_cast<std::size_t>(length);
+		flush(false);
+	};
+
+	write(snprintf(chunk, CHUNK_SIZE, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"));
+
+	for (std::size_t i = 0; i < thread_name_count; i++) {
+		write(snprintf(chunk + size, CHUNK_SIZE - size,
+			"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%.64s\"}}",
+			separator, static_cast<unsigned int>(thread_names[i].thread), thread_names[i].name));
+		separator = ",\n";
+	}
+
+	std::size_t count = next_event.load();
+	if (count > capacity) count = capacity;
+
+	for (std::size_t i = 0; i < count; i++) {
+		const Event& event = events[i];
+
+		char phase = event.phase.load(std::memory_order_acquire);
+		if (phase == 0) continue;
+
+		if (phase == 'b' || phase == 'e') {
+			write(snprintf(chunk + size, CHUNK_SIZE - size,
+				"%s{\"name\":\"%.64s\",\"cat\":\"async\",\"ph\":\"%c\",\"id\":%u,\"ts\":%u,\"pid\":1,\"tid\":%u}",
+				separator, event.name, phase, static_cast<unsigned int>(event.id),
+				static_cast<unsigned int>(event.timestamp), static_cast<unsigned int>(event.thread)));
+		} else {
+			write(snprintf(chunk + size, CHUNK_SIZE - size,
+				"%s{\"name\":\"%.64s\",\"ph\":\"%c\",%s\"ts\":%u,\"pid\":1,\"tid\":%u}",
+				separator, event.name, phase, phase == 'i' ? "\"s\":\"t\"," : "",
+				static_cast<unsigned int>(event.timestamp), static_cast<unsigned int>(event.thread)));
+		}
+
+		separator = ",\n";
+	}
+
+	write(snprintf(chunk + size, CHUNK_SIZE - size, "\n]}\n"));
+	flush(true);
+
+	control_mutex.unlock();
+	return success;
+}
+
+} // namespace trace
+} // namespace tao
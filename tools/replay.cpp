@@ -0,0 +1,249 @@
+/**
+ * @file tools/replay.cpp
+ * @author Tropical
+ *
+ * Replays flight recordings (see DifferentialDrivetrain::start_recording) through the drivetrain's
+ * odometry and control code on a computer, comparing every tick against what the robot recorded.
+ *
+ * Each recording's sensor readings and commands are fed into the tracking loop as fast as they can be
+ * computed, so changes to odometry or the controllers can be checked against many real runs in seconds.
+ * A recording passes if every replayed tick's pose, errors and voltages match the recording within a tolerance.
+ * After a gap in a recording, the replay starts again from the next tick it can, and the ticks in between aren't compared.
+ *
+ * Build (from the root of the repository):
+ *     g++ -std=c++11 -O2 -DTAO_ENV_HOST -Iinclude tools/replay.cpp $(find src/taolib -name "*.cpp") -pthread -o replay
+ *
+ * Usage:
+ *     replay [--tolerance <value>] <recording.csv>...
+ */
+
+#include "taolib/DifferentialDrivetrain.h"
+#include "taolib/FlightRecorder.h"
+#include "taolib/Logger.h"
+#include "taolib/math.h"
+#include "taolib/env.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using tao::DifferentialDrivetrain;
+using tao::FlightRecorder;
+
+namespace {
+
+// Reads a comma-separated list of numbers into `values`.
+void parse_values(const std::string& text, double* values, std::size_t count) {
+	std::stringstream stream(text);
+	std::string value;
+
+	for (std::size_t i = 0; i < count && std::getline(stream, value, ','); i++) {
+		values[i] = std::atof(value.c_str());
+	}
+}
+
+// Parses the config line written at the top of every recording.
+DifferentialDrivetrain::Config parse_config(const std::string& line) {
+	DifferentialDrivetrain::Config config = {};
+	std::stringstream stream(line.substr(std::strlen("# config ")));
+	std::string field;
+
+	while (stream >> field) {
+		std::size_t separator = field.find('=');
+		if (separator == std::string::npos) continue;
+
+		std::string name = field.substr(0, separator);
+		std::string value = field.substr(separator + 1);
+
+		double values[4] = {};
+		parse_values(value, values, 4);
+
+		if (name == "drive_gains") config.drive_gains = { values[0], values[1], values[2], values[3] };
+		else if (name == "turn_gains") config.turn_gains = { values[0], values[1], values[2], values[3] };
+		else if (name == "velocity_gains") config.velocity_gains = { values[0], values[1], values[2], values[3] };
+		else if (name == "left_feedforward") config.left_feedforward = { values[0], values[1], values[2] };
+		else if (name == "right_feedforward") config.right_feedforward = { values[0], values[1], values[2] };
+		else if (name == "drive_tolerance") config.drive_tolerance = values[0];
+		else if (name == "turn_tolerance") config.turn_tolerance = values[0];
+		else if (name == "lookahead_distance") config.lookahead_distance = values[0];
+		else if (name == "track_width") config.track_width = values[0];
+		else if (name == "wheel_diameter") config.wheel_diameter = values[0];
+		else if (name == "gearing") config.gearing = values[0];
+		else if (name == "max_velocity") config.max_velocity = values[0];
+		else if (name == "stall_time") config.stall_time = static_cast<uint32_t>(values[0]);
+		else if (name == "stall_velocity") config.stall_velocity = values[0];
+		else if (name == "collision_acceleration") config.collision_acceleration = values[0];
+	}
+
+	return config;
+}
+
+// A value compared between the recording and the replay.
+struct Comparison {
+	const char* name;
+	double FlightRecorder::Record::*member;
+	bool angle;
+	double max_difference;
+	uint32_t first_mismatch;
+	bool mismatched;
+};
+
+bool replay_recording(const char* path, double tolerance) {
+	std::ifstream file(path);
+	if (!file) {
+		std::fprintf(stderr, "%s: could not open file\n", path);
+		return false;
+	}
+
+	DifferentialDrivetrain::Config config = {};
+	bool has_config = false;
+	std::vector<FlightRecorder::Record> records;
+	bool has_imu = false;
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.compare(0, std::strlen("# config "), "# config ") == 0) {
+			config = parse_config(line);
+			has_config = true;
+			continue;
+		}
+
+		FlightRecorder::Record record;
+		if (FlightRecorder::parse(line.c_str(), record)) {
+			records.push_back(record);
+			has_imu = has_imu || record.sensors.imu_installed;
+		}
+	}
+
+	if (!has_config || records.size() < 2) {
+		std::fprintf(stderr, "%s: not a flight recording\n", path);
+		return false;
+	}
+
+	// The replay never reads from these devices, but the drivetrain still needs something to hold onto.
+	tao::env::MotorGroup left_motors, right_motors;
+	tao::env::IMU imu;
+	tao::Logger logger(std::cerr, tao::Logger::Level::WARNING);
+
+	std::unique_ptr<DifferentialDrivetrain> drivetrain(has_imu
+		? new DifferentialDrivetrain(left_motors, right_motors, imu, config, logger)
+		: new DifferentialDrivetrain(left_motors, right_motors, config, logger));
+
+	Comparison comparisons[] = {
+		{ "x", &FlightRecorder::Record::x, false, 0.0, 0, false },
+		{ "y", &FlightRecorder::Record::y, false, 0.0, 0, false },
+		{ "heading", &FlightRecorder::Record::heading, true, 0.0, 0, false },
+		{ "drive_error", &FlightRecorder::Record::drive_error, false, 0.0, 0, false },
+		{ "turn_error", &FlightRecorder::Record::turn_error, true, 0.0, 0, false },
+		{ "left_voltage", &FlightRecorder::Record::left_voltage, false, 0.0, 0, false },
+		{ "right_voltage", &FlightRecorder::Record::right_voltage, false, 0.0, 0, false },
+	};
+
+	auto start = std::chrono::steady_clock::now();
+
+	// A recording that wrapped around may start on a tick that can't be replayed from, so the replay starts from the next one.
+	std::size_t first = 0;
+	while (first < records.size() && !drivetrain->begin_replay(records[first])) first++;
+
+	if (records.size() - first < 2) {
+		std::fprintf(stderr, "%s: no tick to start replaying from\n", path);
+		return false;
+	}
+
+	std::size_t replayed = 0;
+	std::size_t gaps = 0;
+	std::size_t skipped = 0;
+
+	for (std::size_t i = first + 1; i < records.size(); i++) {
+		FlightRecorder::Record output;
+
+		// Ticks are missing before this one (such as if the recorder overwrote them while it was being dumped), so the
+		// replay starts again from the first tick it can. Ticks before then count towards the gap rather than as mismatches.
+		if (!drivetrain->replay_tick(records[i], output)) {
+			if (records[i].tick != records[i - 1].tick + 1) gaps++;
+			skipped++;
+			drivetrain->begin_replay(records[i]);
+			continue;
+		}
+
+		replayed++;
+
+		for (Comparison& comparison : comparisons) {
+			double difference = output.*comparison.member - records[i].*comparison.member;
+			if (comparison.angle) difference = tao::math::normalize_degrees(difference);
+			difference = std::abs(difference);
+
+			if (difference > comparison.max_difference) comparison.max_difference = difference;
+
+			if (difference > tolerance && !comparison.mismatched) {
+				comparison.mismatched = true;
+				comparison.first_mismatch = records[i].tick;
+			}
+		}
+	}
+
+	drivetrain->end_replay();
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	bool passed = true;
+	for (const Comparison& comparison : comparisons) {
+		if (comparison.mismatched) passed = false;
+	}
+
+	std::printf("%s: %s (%zu ticks in %.3fs)\n", path, passed ? "PASS" : "FAIL", replayed, elapsed);
+
+	if (gaps > 0) {
+		std::printf("    %zu gap(s) in the recording, %zu tick(s) not compared\n", gaps, skipped);
+	}
+
+	for (const Comparison& comparison : comparisons) {
+		if (comparison.mismatched) {
+			std::printf("    %-14s max difference %.6f, first exceeded tolerance on tick %u\n",
+				comparison.name, comparison.max_difference, static_cast<unsigned int>(comparison.first_mismatch));
+		} else {
+			std::printf("    %-14s max difference %.6f\n", comparison.name, comparison.max_difference);
+		}
+	}
+
+	return passed;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	double tolerance = 1e-3;
+	std::vector<const char*> paths;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+			tolerance = std::atof(argv[++i]);
+		} else if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+			std::fprintf(stderr, "Usage: %s [--tolerance <value>] <recording.csv>...\n", argv[0]);
+			return 0;
+		} else {
+			paths.push_back(argv[i]);
+		}
+	}
+
+	if (paths.empty()) {
+		std::fprintf(stderr, "Usage: %s [--tolerance <value>] <recording.csv>...\n", argv[0]);
+		return 1;
+	}
+
+	int failures = 0;
+	for (const char* path : paths) {
+		if (!replay_recording(path, tolerance)) failures++;
+	}
+
+	std::printf("%zu recording(s), %d failed\n", paths.size(), failures);
+
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file tools/telemetry_decoder.cpp
+ * @author Tropical
+ *
+ * Host-side decoder for binary telemetry frames (see include/taolib/telemetry.h).
+ *
+ * Reads a captured serial stream (which may also contain text logs) from a file or stdin,
+ * and writes each decoded sample to stdout as CSV or JSON lines.
+ *
+ * Build:
+ *     g++ -std=c++11 -O2 -Iinclude tools/telemetry_decoder.cpp src/taolib/telemetry.cpp -o telemetry_decoder
+ *
+ * Usage:
+ *     telemetry_decoder [--json] [capture file]
+ */
+
+#include "taolib/telemetry.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+void print_csv_header() {
+	std::printf("timestamp,x,y,heading,drive_error,turn_error,drive_p,drive_i,drive_d,turn_p,turn_i,turn_d,left_voltage,right_voltage\n");
+}
+
+void print_csv(const tao::telemetry::Sample& sample) {
+	std::printf("%.6f,%.3f,%.3f,%.2f,%.3f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.3f,%.3f\n",
+		sample.timestamp / 1000000.0,
+		sample.x, sample.y, sample.heading,
+		sample.drive_error, sample.turn_error,
+		sample.drive_p, sample.drive_i, sample.drive_d,
+		sample.turn_p, sample.turn_i, sample.turn_d,
+		sample.left_voltage, sample.right_voltage);
+}
+
+void print_json(const tao::telemetry::Sample& sample) {
+	std::printf("{\"timestamp\":%.6f,\"position\":{\"x\":%.3f,\"y\":%.3f},\"heading\":%.2f,"
+		"\"error\":{\"drive\":%.3f,\"turn\":%.2f},"
+		"\"pid\":{\"drive\":{\"p\":%.2f,\"i\":%.2f,\"d\":%.2f},\"turn\":{\"p\":%.2f,\"i\":%.2f,\"d\":%.2f}},"
+		"\"voltage\":{\"left\":%.3f,\"right\":%.3f}}\n",
+		sample.timestamp / 1000000.0,
+		sample.x, sample.y, sample.heading,
+		sample.drive_error, sample.turn_error,
+		sample.drive_p, sample.drive_i, sample.drive_d,
+		sample.turn_p, sample.turn_i, sample.turn_d,
+		sample.left_voltage, sample.right_voltage);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	bool json = false;
+	const char* path = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--json") == 0) {
+			json = true;
+		} else if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+			std::fprintf(stderr, "Usage: %s [--json] [capture file]\n", argv[0]);
+			return 0;
+		} else {
+			path = argv[i];
+		}
+	}
+
+	std::FILE* input = path != nullptr ? std::fopen(path, "rb") : stdin;
+	if (input == nullptr) {
+		std::fprintf(stderr, "Could not open %s\n", path);
+		return 1;
+	}
+
+	if (!json) print_csv_header();
+
+	tao::telemetry::FrameDecoder decoder;
+	tao::telemetry::Sample sample;
+	uint32_t sample_count = 0;
+
+	int byte;
+	while ((byte = std::fgetc(input)) != EOF) {
+		if (decoder.push(static_cast<uint8_t>(byte), sample)) {
+			if (json) {
+				print_json(sample);
+			} else {
+				print_csv(sample);
+			}
+
+			sample_count++;
+		}
+	}
+
+	if (input != stdin) std::fclose(input);
+
+	std::fprintf(stderr, "Decoded %u samples, lost %u frames.\n",
+		static_cast<unsigned int>(sample_count), static_cast<unsigned int>(decoder.get_lost_frames()));
+
+	return 0;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file tools/trig_benchmark.cpp
+ * @author Tropical
+ *
+ * Measures the accuracy and speed of the fast trig functions in taolib/trig.h against the standard library.
+ *
+ * Errors are measured against long double libm over a large set of random inputs, and timings are the average time
+ * per call over the same inputs. Timings on a computer don't carry over to the brain directly, but the error bounds do.
+ *
+ * Build (from the root of the repository):
+ *     g++ -std=c++11 -O2 -Iinclude tools/trig_benchmark.cpp -o trig_benchmark
+ *
+ * Usage:
+ *     trig_benchmark [samples]
+ */
+
+#include "taolib/trig.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Keeps the compiler from optimizing away benchmarked calls.
+volatile double sink;
+
+template <typename T, typename Function>
+double time_per_call(const std::vector<T>& inputs, Function function) {
+	auto start = std::chrono::steady_clock::now();
+
+	T sum = 0;
+	for (T input : inputs) {
+		sum += function(input);
+	}
+	sink = sum;
+
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / inputs.size();
+}
+
+template <typename T, typename Fast, typename Reference>
+double max_error(const std::vector<T>& inputs, Fast fast, Reference reference) {
+	double error = 0.0;
+
+	for (T input : inputs) {
+		long double difference = std::fabs(static_cast<long double>(fast(input)) - reference(static_cast<long double>(input)));
+		if (difference > error) error = static_cast<double>(difference);
+	}
+
+	return error;
+}
+
+// Two-argument versions, for atan2.
+template <typename T, typename Function>
+double time_per_call_2(const std::vector<T>& ys, const std::vector<T>& xs, Function function) {
+	auto start = std::chrono::steady_clock::now();
+
+	T sum = 0;
+	for (std::size_t i = 0; i < ys.size(); i++) {
+		sum += function(ys[i], xs[i]);
+	}
+	sink = sum;
+
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / ys.size();
+}
+
+template <typename T, typename Fast, typename Reference>
+double max_error_2(const std::vector<T>& ys, const std::vector<T>& xs, Fast fast, Reference reference) {
+	double error = 0.0;
+
+	for (std::size_t i = 0; i < ys.size(); i++) {
+		long double expected = reference(static_cast<long double>(ys[i]), static_cast<long double>(xs[i]));
+		long double difference = std::fabs(static_cast<long double>(fast(ys[i], xs[i])) - expected);
+		if (difference > error) error = static_cast<double>(difference);
+	}
+
+	return error;
+}
+
+template <typename T>
+std::vector<T> random_inputs(std::size_t count, double range, std::mt19937_64& random) {
+	std::uniform_real_distribution<double> distribution(-range, range);
+
+	std::vector<T> inputs(count);
+	for (T& input : inputs) {
+		input = static_cast<T>(distribution(random));
+	}
+
+	return inputs;
+}
+
+void print_row(const char* name, double error, double fast_time, double std_time) {
+	std::printf("%-16s %12.3g %10.2f %10.2f %8.2fx\n", name, error, fast_time, std_time, std_time / fast_time);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	std::size_t samples = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+	std::mt19937_64 random(126);
+
+	// Ranges match the error bounds documented in trig.h. Headings in the tracking loop stay well within these.
+	std::vector<double> angles = random_inputs<double>(samples, 1e5, random);
+	std::vector<float> angles_f = random_inputs<float>(samples, 1e3, random);
+	std::vector<double> small_angles = random_inputs<double>(samples, 2.0 * 3.14159265358979323846, random);
+	std::vector<double> coordinates = random_inputs<double>(samples, 100.0, random);
+	std::vector<double> coordinates_x = random_inputs<double>(samples, 100.0, random);
+	std::vector<float> coordinates_f = random_inputs<float>(samples, 100.0, random);
+	std::vector<float> coordinates_fx = random_inputs<float>(samples, 100.0, random);
+
+	std::printf("%-16s %12s %10s %10s %9s\n", "function", "max error", "fast (ns)", "std (ns)", "speedup");
+
+	print_row("sin",
+		max_error(angles, [](double x) { return tao::math::fast_sin(x); }, [](long double x) { return std::sin(x); }),
+		time_per_call(angles, [](double x) { return tao::math::fast_sin(x); }),
+		time_per_call(angles, [](double x) { return std::sin(x); }));
+
+	print_row("cos",
+		max_error(angles, [](double x) { return tao::math::fast_cos(x); }, [](long double x) { return std::cos(x); }),
+		time_per_call(angles, [](double x) { return tao::math::fast_cos(x); }),
+		time_per_call(angles, [](double x) { return std::cos(x); }));
+
+	print_row("sincos (-2pi,2pi)",
+		max_error(small_angles, [](double x) { return tao::math::sincos(x).sin; }, [](long double x) { return std::sin(x); }),
+		time_per_call(small_angles, [](double x) { tao::math::SinCos<double> result = tao::math::sincos(x); return result.sin + result.cos; }),
+		time_per_call(small_angles, [](double x) { return std::sin(x) + std::cos(x); }));
+
+	print_row("sin (float)",
+		max_error(angles_f, [](float x) { return tao::math::fast_sin(x); }, [](long double x) { return std::sin(x); }),
+		time_per_call(angles_f, [](float x) { return tao::math::fast_sin(x); }),
+		time_per_call(angles_f, [](float x) { return std::sin(x); }));
+
+	print_row("cos (float)",
+		max_error(angles_f, [](float x) { return tao::math::fast_cos(x); }, [](long double x) { return std::cos(x); }),
+		time_per_call(angles_f, [](float x) { return tao::math::fast_cos(x); }),
+		time_per_call(angles_f, [](float x) { return std::cos(x); }));
+
+	print_row("atan2",
+		max_error_2(coordinates, coordinates_x, [](double y, double x) { return tao::math::fast_atan2(y, x); },
+			[](long double y, long double x) { return std::atan2(y, x); }),
+		time_per_call_2(coordinates, coordinates_x, [](double y, double x) { return tao::math::fast_atan2(y, x); }),
+		time_per_call_2(coordinates, coordinates_x, [](double y, double x) { return std::atan2(y, x); }));
+
+	print_row("atan2 (float)",
+		max_error_2(coordinates_f, coordinates_fx, [](float y, float x) { return tao::math::fast_atan2(y, x); },
+			[](long double y, long double x) { return std::atan2(y, x); }),
+		time_per_call_2(coordinates_f, coordinates_fx, [](float y, float x) { return tao::math::fast_atan2(y, x); }),
+		time_per_call_2(coordinates_f, coordinates_fx, [](float y, float x) { return std::atan2(y, x); }));
+
+	return 0;
+}